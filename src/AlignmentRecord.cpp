@@ -22,6 +22,7 @@
 #include <ctype.h>
 #include <map>
 #include <array>
+#include <limits>
 
 #include <boost/tokenizer.hpp>
 #include <boost/lexical_cast.hpp>
@@ -37,6 +38,9 @@ using namespace boost;
 
 /** helper functions to merge DNA sequences. */
 namespace {
+/** cliques with at least this many single end alignments at the front merge them in one pass. */
+const size_t PILEUP_MIN_ALIGNMENTS = 3;
+
 int agreement(const char& qual1, const char& qual2){
     float prob1 = std::pow(10,(float)-qual1/10);
     float prob2 = std::pow(10,(float)-qual2/10);
@@ -88,6 +92,28 @@ std::array<std::array<int, 127>, 127> compute_error_disagreement(){
 std::array<float, 127> error_probs = compute_error_probs();
 std::array<std::array<int, 127>, 127> error_agreement = compute_error_agreement();
 std::array<std::array<int, 127>, 127> error_disagreement = compute_error_disagreement();
+
+/** 2-bit code of a base, -1 for anything that is not A, C, G or T. */
+int baseCode(char base){
+    switch(base){
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return -1;
+    }
+}
+
+/** returns the 32 packed positions of words starting at position offset, positions past the end are zero. */
+uint64_t packedWindow(const std::vector<uint64_t>& words, unsigned int offset){
+    unsigned int w = offset / 32;
+    unsigned int shift = (offset % 32) * 2;
+    uint64_t result = (w < words.size()) ? words[w] >> shift : 0;
+    if (shift != 0 && w + 1 < words.size()) {
+        result |= words[w + 1] << (64 - shift);
+    }
+    return result;
+}
 }
 /** calculates the total phred value */
 int phred_sum(const string& phred, char phred_base=33) {
@@ -183,7 +209,7 @@ std::pair<char,char> computeEntry(const char& base1, const char& qual1, const ch
     return result;
 }
 
-AlignmentRecord::AlignmentRecord(const BamTools::BamAlignment& bam_alignment, int read_ref, vector<string>* rnm) : readNameMap(rnm) {
+AlignmentRecord::AlignmentRecord(const BamTools::BamAlignment& bam_alignment, int read_ref, vector<string>* rnm) : readNameMap(rnm), readFamilies(nullptr), packed_start(0), packed(false), indel_free(false) {
     this->single_end = true;
     this->readNames.insert(read_ref);
     this->name = bam_alignment.Name;
@@ -208,7 +234,7 @@ AlignmentRecord::AlignmentRecord(const BamTools::BamAlignment& bam_alignment, in
     this->cov_pos = this->coveredPositions();
 }
 
-AlignmentRecord::AlignmentRecord(unique_ptr<vector<const AlignmentRecord*>>& alignments, unsigned int clique_id) : cigar1_unrolled(), cigar2_unrolled() {
+AlignmentRecord::AlignmentRecord(unique_ptr<vector<const AlignmentRecord*>>& alignments, unsigned int clique_id) : cigar1_unrolled(), cigar2_unrolled(), packed_start(0), packed(false), indel_free(false) {
     // no longer majority vote, phred scores are updated according to Edgar et al.
     assert ((*alignments).size()>1);
     // get first AlignmentRecord
@@ -219,6 +245,7 @@ AlignmentRecord::AlignmentRecord(unique_ptr<vector<const AlignmentRecord*>>& ali
     this->cigar1_unrolled = al1->getCigar1Unrolled();
     this->sequence1 = al1->getSequence1();
     this->readNameMap = al1->readNameMap;
+    this->readFamilies = al1->readFamilies;
     this->readNames.insert(al1->readNames.begin(), al1->readNames.end());
     this->single_end = al1->isSingleEnd();
 
@@ -229,23 +256,174 @@ AlignmentRecord::AlignmentRecord(unique_ptr<vector<const AlignmentRecord*>>& ali
         this->cigar2_unrolled = al1->getCigar2Unrolled();
         this->sequence2 = al1->getSequence2();
     }
+    // single end alignments at the front are merged in one pass if possible
+    unsigned int merged = 1;
+    unsigned int single_ends = 0;
+    while (single_ends < (*alignments).size() && (*alignments)[single_ends]->isSingleEnd()) single_ends++;
+    if (single_ends >= PILEUP_MIN_ALIGNMENTS && pileupMergeSingle(*alignments, single_ends)) {
+        merged = single_ends;
+    }
     // merge recent AlignmentRecord with all other alignments of Clique
-    for (unsigned int i = 1; i < (*alignments).size(); i++){
-        auto& al = (*alignments)[i];
-        if (this->single_end && al->isSingleEnd()){
-            mergeAlignmentRecordsSingle(*al,1,1);
-        }
-        else if (!(this->single_end) && al->isPairedEnd()){
-            mergeAlignmentRecordsPaired(*al);
-        }
-        else {
-            mergeAlignmentRecordsMixed(*al);
-        }
-        this->readNames.insert(al->readNames.begin(),al->readNames.end());
+    for (unsigned int i = merged; i < (*alignments).size(); i++){
+        mergeWith(*(*alignments)[i]);
     }
     // update name of new Clique Superread
     this->name = "Clique_" + to_string(clique_id);
-    this->cov_pos=this->coveredPositions();
+    // the pileup pass already built cov_pos if it merged all alignments
+    if (merged < (*alignments).size()) {
+        this->cov_pos=this->coveredPositions();
+    }
+}
+
+void AlignmentRecord::mergeWith(const AlignmentRecord& ar) {
+    if (this->single_end && ar.isSingleEnd()){
+        mergeAlignmentRecordsSingle(ar,1,1);
+    }
+    else if (!(this->single_end) && ar.isPairedEnd()){
+        mergeAlignmentRecordsPaired(ar);
+    }
+    else {
+        mergeAlignmentRecordsMixed(ar);
+    }
+    this->readNames.insert(ar.readNames.begin(),ar.readNames.end());
+    this->packed = false;
+}
+
+bool AlignmentRecord::pileupMergeSingle(const std::vector<const AlignmentRecord*>& alignments, size_t count) {
+    // per alignment: next position in the unrolled cigar and in the sequence, and the
+    // reference range including clipped bases
+    struct cursor_t {
+        const std::vector<char>* cigar;
+        const ShortDnaSequence* sequence;
+        int ref_start;
+        int ref_end;
+        size_t c_pos;
+        size_t q_pos;
+        bool covers(int ref_pos) const { return ref_start <= ref_pos && ref_pos <= ref_end; }
+    };
+    std::vector<cursor_t> cursors(count);
+    int first = std::numeric_limits<int>::max();
+    int last = std::numeric_limits<int>::min();
+    int start = this->start1;
+    for (size_t k = 0; k < count; ++k) {
+        const AlignmentRecord& ar = *alignments[k];
+        cursor_t& cursor = cursors[k];
+        cursor.cigar = &ar.getCigar1Unrolled();
+        cursor.sequence = &ar.getSequence1();
+        cursor.ref_start = ar.getStart1() - computeOffset(*cursor.cigar);
+        cursor.ref_end = ar.getEnd1() + computeRevOffset(*cursor.cigar);
+        cursor.c_pos = 0;
+        cursor.q_pos = 0;
+        first = std::min(first, cursor.ref_start);
+        last = std::max(last, cursor.ref_end);
+        start = std::min(start, ar.getStart1());
+    }
+
+    std::string dna;
+    std::string qualities;
+    std::string cigar_unrolled_new;
+    dna.reserve(last - first + 1);
+    qualities.reserve(last - first + 1);
+    cigar_unrolled_new.reserve(last - first + 1);
+    // covered positions of the super read, counted as coveredPositions() counts them
+    std::vector<mapValue> cov_positions;
+    cov_positions.reserve(last - first + 1);
+    int r = start;
+    std::pair<char,char> entry;
+    for (int ref_pos = first; ref_pos <= last; ++ref_pos) {
+        // Insertions before ref_pos: the pairwise merge combines them position by position
+        // if all alignments around them have an insertion of the same length.
+        bool any_insertion = false;
+        for (const auto& cursor : cursors) {
+            if (cursor.c_pos < cursor.cigar->size() && (*cursor.cigar)[cursor.c_pos] == 'I') any_insertion = true;
+        }
+        if (any_insertion) {
+            size_t insertion = 0;
+            for (const auto& cursor : cursors) {
+                bool covers_previous = cursor.covers(ref_pos - 1);
+                bool covers_next = cursor.covers(ref_pos);
+                if (!covers_previous && !covers_next) continue;
+                if (!covers_previous || !covers_next) return false;
+                char previous = (*cursor.cigar)[cursor.c_pos - 1];
+                size_t length = 0;
+                while (cursor.c_pos + length < cursor.cigar->size() && (*cursor.cigar)[cursor.c_pos + length] == 'I') length++;
+                if (cursor.c_pos + length == cursor.cigar->size()) return false;
+                char next = (*cursor.cigar)[cursor.c_pos + length];
+                if ((previous != 'M' && previous != 'D') || (next != 'M' && next != 'D')) return false;
+                if (length == 0 || (insertion != 0 && length != insertion)) return false;
+                insertion = length;
+            }
+            for (size_t i = 0; i < insertion; ++i) {
+                bool have_base = false;
+                for (auto& cursor : cursors) {
+                    if (!cursor.covers(ref_pos - 1)) continue;
+                    char base = (*cursor.sequence)[cursor.q_pos];
+                    char quality = cursor.sequence->qualityChar(cursor.q_pos);
+                    entry = have_base ? computeEntry(entry.first, entry.second, base, quality) : std::make_pair(base, quality);
+                    have_base = true;
+                    cursor.c_pos++;
+                    cursor.q_pos++;
+                }
+                dna += entry.first;
+                qualities += entry.second;
+                cigar_unrolled_new += 'I';
+            }
+        }
+
+        // the column itself: matches are folded in the order of the alignments, clipped
+        // bases are left out
+        bool have_match = false;
+        bool have_deletion = false;
+        for (auto& cursor : cursors) {
+            if (!cursor.covers(ref_pos)) continue;
+            if (cursor.c_pos >= cursor.cigar->size()) return false;
+            char c = (*cursor.cigar)[cursor.c_pos];
+            if (c == 'M') {
+                char base = (*cursor.sequence)[cursor.q_pos];
+                char quality = cursor.sequence->qualityChar(cursor.q_pos);
+                entry = have_match ? computeEntry(entry.first, entry.second, base, quality) : std::make_pair(base, quality);
+                have_match = true;
+                cursor.q_pos++;
+            } else if (c == 'D') {
+                have_deletion = true;
+            } else if (c == 'S') {
+                cursor.q_pos++;
+            } else if (c != 'H') {
+                return false;
+            }
+            cursor.c_pos++;
+        }
+        // the pairwise merge does not resolve a match against a deletion
+        if (have_match && have_deletion) return false;
+        if (have_match) {
+            cov_positions.push_back({r, entry.first, entry.second, error_probs[entry.second], (int)dna.size(), 0});
+            dna += entry.first;
+            qualities += entry.second;
+            cigar_unrolled_new += 'M';
+            ++r;
+        } else if (have_deletion) {
+            cigar_unrolled_new += 'D';
+            ++r;
+        }
+    }
+    for (const auto& cursor : cursors) {
+        if (cursor.c_pos != cursor.cigar->size()) return false;
+    }
+
+    for (size_t k = 1; k < count; ++k) {
+        this->start1 = std::min(this->start1, alignments[k]->getStart1());
+        this->end1 = std::max(this->end1, alignments[k]->getEnd1());
+        this->readNames.insert(alignments[k]->readNames.begin(), alignments[k]->readNames.end());
+    }
+    this->single_end = true;
+    this->cigar1 = createCigar(cigar_unrolled_new);
+    this->sequence1 = ShortDnaSequence(dna, qualities);
+    this->phred_sum1 = phred_sum(qualities);
+    this->length_incl_deletions1 = this->sequence1.size();
+    this->length_incl_longdeletions1 = this->sequence1.size();
+    this->cigar1_unrolled.assign(cigar_unrolled_new.begin(), cigar_unrolled_new.end());
+    this->cov_pos.swap(cov_positions);
+    return true;
 }
 
 void AlignmentRecord::pairWith(const BamTools::BamAlignment& bam_alignment) {
@@ -377,6 +555,63 @@ std::vector<AlignmentRecord::mapValue> AlignmentRecord::coveredPositions() const
     return cov_positions;
 }
 
+void AlignmentRecord::packBases(){
+    if (this->packed) return;
+    this->packed = true;
+    this->packed_bases.clear();
+    this->packed_mask.clear();
+    this->packed_start = 0;
+    this->indel_free = true;
+    for (char c : this->cigar1_unrolled) {
+        if (c == 'I' || c == 'D') this->indel_free = false;
+    }
+    if (!this->single_end) {
+        for (char c : this->cigar2_unrolled) {
+            if (c == 'I' || c == 'D') this->indel_free = false;
+        }
+    }
+    if (this->cov_pos.empty()) return;
+    this->packed_start = this->cov_pos.front().ref;
+    unsigned int length = this->cov_pos.back().ref - this->packed_start + 1;
+    this->packed_bases.assign((length + 31) / 32, 0);
+    this->packed_mask.assign((length + 31) / 32, 0);
+    int last_ref = this->packed_start - 1;
+    for (const auto& v : this->cov_pos) {
+        // overlapping segments have no unique base per position
+        if (v.ref <= last_ref) {
+            this->indel_free = false;
+            continue;
+        }
+        last_ref = v.ref;
+        int code = baseCode(v.base);
+        if (code < 0) continue;
+        unsigned int p = v.ref - this->packed_start;
+        this->packed_bases[p / 32] |= (uint64_t)code << ((p % 32) * 2);
+        this->packed_mask[p / 32] |= (uint64_t)1 << ((p % 32) * 2);
+    }
+}
+
+unsigned int AlignmentRecord::countMismatches(const AlignmentRecord& ar, unsigned int& overlap) const{
+    overlap = 0;
+    if (this->packed_bases.empty() || ar.packed_bases.empty()) return 0;
+    int first = std::max(this->packed_start, ar.packed_start);
+    int last = std::min(this->packed_start + 32 * (int)this->packed_bases.size(), ar.packed_start + 32 * (int)ar.packed_bases.size()) - 1;
+    unsigned int mismatches = 0;
+    for (int pos = first; pos <= last; pos += 32) {
+        unsigned int o1 = pos - this->packed_start;
+        unsigned int o2 = pos - ar.packed_start;
+        uint64_t common = packedWindow(this->packed_mask, o1) & packedWindow(ar.packed_mask, o2);
+        if (last - pos < 31) {
+            common &= ((uint64_t)1 << ((last - pos + 1) * 2)) - 1;
+        }
+        uint64_t diff = packedWindow(this->packed_bases, o1) ^ packedWindow(ar.packed_bases, o2);
+        diff = (diff | (diff >> 1)) & common;
+        mismatches += __builtin_popcountll(diff);
+        overlap += __builtin_popcountll(common);
+    }
+    return mismatches;
+}
+
 void AlignmentRecord::getMergedDnaSequence(const BamTools::BamAlignment& bam_alignment){
         std::string dna = "";
         std::string qualities = "";
@@ -1713,6 +1948,10 @@ std::string AlignmentRecord::getName() const {
 	return name;
 }
 
+void AlignmentRecord::setName(const std::string& name) {
+	this->name = name;
+}
+
 int AlignmentRecord::getStart1() const {
 	return start1;
 }
@@ -1810,21 +2049,67 @@ int AlignmentRecord::getLengthInclLongDeletions2() const {
 	return this->length_incl_longdeletions2;
 }
 
+unsigned int AlignmentRecord::getMoleculeCount() const {
+    if (this->readFamilies == nullptr) return this->readNames.size();
+    unsigned int molecules = 0;
+    for (int i : this->readNames) {
+        if ((*this->readFamilies)[i] == i) ++molecules;
+    }
+    return molecules;
+}
+
+read_set_fingerprint_t AlignmentRecord::getFingerprint() const {
+    read_set_fingerprint_t fingerprint;
+    for (int i : this->readNames) {
+        fingerprint.add(i);
+    }
+    return fingerprint;
+}
+
+uint64_t AlignmentRecord::getContentHash() const {
+    uint64_t hash = read_set_fingerprint_t::mix(this->single_end ? 1 : 2);
+    auto combine = [&hash](uint64_t value) {
+        hash = read_set_fingerprint_t::mix(hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2)));
+    };
+    std::hash<std::string> string_hash;
+    combine(this->start1);
+    combine(this->end1);
+    combine(string_hash(this->sequence1.toString()));
+    combine(string_hash(this->sequence1.qualityString()));
+    combine(string_hash(std::string(this->cigar1_unrolled.begin(), this->cigar1_unrolled.end())));
+    if (!this->single_end) {
+        combine(this->start2);
+        combine(this->end2);
+        combine(string_hash(this->sequence2.toString()));
+        combine(string_hash(this->sequence2.qualityString()));
+        combine(string_hash(std::string(this->cigar2_unrolled.begin(), this->cigar2_unrolled.end())));
+    }
+    return hash;
+}
+
 double setProbabilities(std::deque<AlignmentRecord*>& reads) {
     double read_usage_ct = 0.0;
     double mean = 1.0 / reads.size();
 
     for(auto&& r : reads) {
-        read_usage_ct += r->getReadCount();
+        read_usage_ct += r->getMoleculeCount();
     }
 
     if (not reads.empty()) {
-        read_usage_ct = max(read_usage_ct, (double) reads[0]->readNameMap->size());
+        double molecules = reads[0]->readNameMap->size();
+        if (reads[0]->readFamilies != nullptr) {
+            const auto& families = *(reads[0]->readFamilies);
+            molecules = 0.0;
+            for (size_t i = 0; i < families.size(); ++i) {
+                if (families[i] == (int) i) molecules += 1.0;
+            }
+        }
+        read_usage_ct = max(read_usage_ct, molecules);
     }
     double stdev = 0.0;
 
     for (auto&& r : reads) {
-        r->probability = r->getReadCount() / read_usage_ct;
+        r->probability = r->getMoleculeCount() / read_usage_ct;
         
         stdev += (r->probability - mean)*(r->probability - mean);
     }
@@ -1832,6 +2117,138 @@ double setProbabilities(std::deque<AlignmentRecord*>& reads) {
     return sqrt(1.0 / (reads.size() - 1) * stdev);
 }
 
+size_t pruneContainedReads(std::deque<AlignmentRecord*>& reads) {
+    for (auto&& r : reads) {
+        r->packBases();
+    }
+    // containers have to be visited before the reads they contain
+    std::vector<AlignmentRecord*> order(reads.begin(), reads.end());
+    std::stable_sort(order.begin(), order.end(), [](const AlignmentRecord* r1, const AlignmentRecord* r2) {
+        if (r1->getIntervalStart() != r2->getIntervalStart()) return r1->getIntervalStart() < r2->getIntervalStart();
+        if (r1->getIntervalEnd() != r2->getIntervalEnd()) return r1->getIntervalEnd() > r2->getIntervalEnd();
+        return r1->cov_pos.size() > r2->cov_pos.size();
+    });
+    std::set<const AlignmentRecord*> removed;
+    // possible containers by interval end, in visiting order for equal ends
+    std::multimap<unsigned int, AlignmentRecord*> active;
+    for (auto&& r : order) {
+        if (!r->indel_free) continue;
+        // drop candidates that end before r starts
+        while (!active.empty() && active.begin()->first < r->getIntervalStart()) {
+            active.erase(active.begin());
+        }
+        unsigned int bases = 0;
+        for (uint64_t w : r->packed_mask) {
+            bases += __builtin_popcountll(w);
+        }
+        // only candidates that end at or after r can contain it, the closest fitting one is taken
+        AlignmentRecord* container = nullptr;
+        for (auto it = active.lower_bound(r->getIntervalEnd()); it != active.end(); ++it) {
+            unsigned int overlap = 0;
+            if (it->second->countMismatches(*r, overlap) == 0 && overlap == bases) {
+                container = it->second;
+                break;
+            }
+        }
+        if (container != nullptr) {
+            container->readNames.insert(r->readNames.begin(), r->readNames.end());
+            removed.insert(r);
+        } else {
+            active.insert(std::make_pair(r->getIntervalEnd(), r));
+        }
+    }
+    std::deque<AlignmentRecord*> pruned;
+    for (auto&& r : reads) {
+        if (removed.count(r) > 0) {
+            delete r;
+        } else {
+            pruned.push_back(r);
+        }
+    }
+    reads.swap(pruned);
+    return removed.size();
+}
+
+size_t collapseUmiFamilies(std::deque<AlignmentRecord*>& reads, std::vector<int>& read_families) {
+    if (reads.empty()) return 0;
+    read_families.resize(reads[0]->readNameMap->size());
+    for (size_t i = 0; i < read_families.size(); ++i) {
+        read_families[i] = i;
+    }
+    std::unordered_map<std::string, AlignmentRecord*> families;
+    std::deque<AlignmentRecord*> collapsed;
+    std::set<AlignmentRecord*> consensus;
+    size_t removed = 0;
+    for (auto&& r : reads) {
+        r->readFamilies = &read_families;
+        if (r->umi.empty()) {
+            collapsed.push_back(r);
+            continue;
+        }
+        std::string key = r->umi + ":" + to_string(r->start1) + ":" + to_string(r->end1);
+        if (!r->single_end) {
+            key += ":" + to_string(r->start2) + ":" + to_string(r->end2);
+        }
+        auto it = families.find(key);
+        if (it == families.end()) {
+            families.emplace(std::move(key), r);
+            collapsed.push_back(r);
+        } else {
+            AlignmentRecord* head = it->second;
+            int family = *(head->readNames.begin());
+            for (int i : r->readNames) {
+                read_families[i] = family;
+            }
+            head->mergeWith(*r);
+            consensus.insert(head);
+            delete r;
+            ++removed;
+        }
+    }
+    for (auto&& r : consensus) {
+        r->cov_pos = r->coveredPositions();
+    }
+    reads.swap(collapsed);
+    return removed;
+}
+
+size_t collapseDuplicates(std::deque<AlignmentRecord*>& reads, int quality_bin_width) {
+    if (quality_bin_width < 1) quality_bin_width = 1;
+    auto append_segment = [quality_bin_width](std::string& key, int start, const std::vector<char>& cigar, const ShortDnaSequence& sequence) {
+        key += to_string(start);
+        key += ':';
+        key.append(cigar.begin(), cigar.end());
+        key += ':';
+        key += sequence.toString();
+        key += ':';
+        for (char q : sequence.qualityString()) {
+            key += (char) (33 + (q - 33) / quality_bin_width);
+        }
+        key += ';';
+    };
+    std::unordered_map<std::string, AlignmentRecord*> representatives;
+    std::deque<AlignmentRecord*> collapsed;
+    size_t removed = 0;
+    for (auto&& r : reads) {
+        std::string key = r->single_end ? "S;" : "P;";
+        append_segment(key, r->start1, r->cigar1_unrolled, r->sequence1);
+        if (!r->single_end) {
+            append_segment(key, r->start2, r->cigar2_unrolled, r->sequence2);
+        }
+        auto it = representatives.find(key);
+        if (it == representatives.end()) {
+            representatives.emplace(std::move(key), r);
+            collapsed.push_back(r);
+        } else {
+            it->second->readNames.insert(r->readNames.begin(), r->readNames.end());
+            delete r;
+            ++removed;
+        }
+    }
+    reads.swap(collapsed);
+    return removed;
+}
+
 void printReads(std::ostream& outfile, std::deque<AlignmentRecord*>& reads, int doc_haplotypes) {
     auto comp = [](AlignmentRecord* ar1, AlignmentRecord* ar2) { return ar1->probability > ar2->probability; };
     std::sort(reads.begin(), reads.end(), comp);
@@ -2513,6 +2930,7 @@ bool AlignmentRecord::operator ==(const AlignmentRecord& ar) const{
 
 void AlignmentRecord::setCovmap(const std::vector<mapValue>& tmp_cov_map){
     this->cov_pos = tmp_cov_map;
+    this->packed = false;
 }
 
 
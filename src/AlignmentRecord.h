@@ -25,6 +25,7 @@
 #include <set>
 #include <tuple>
 #include <unordered_map>
+#include <cstdint>
 
 #include <api/BamAux.h>
 #include <api/BamAlignment.h>
@@ -74,6 +75,19 @@ private:
 	bool single_end;
 	std::set<int> readNames;
     std::vector<std::string>* readNameMap;
+    /** maps every read id to the id of the first read of its UMI family, nullptr if reads were not grouped into families. */
+    const std::vector<int>* readFamilies;
+    /** unique molecular identifier of the read, empty if the input carries none. */
+    std::string umi;
+    /** reference aligned 2-bit encoding of the covered bases (A=0, C=1, G=2, T=3), 32 positions per word starting at packed_start. */
+    std::vector<uint64_t> packed_bases;
+    /** marks positions of packed_bases holding an A, C, G or T by setting the lower bit of their 2-bit slot. */
+    std::vector<uint64_t> packed_mask;
+    int packed_start;
+    /** true once packBases() has run; cleared when the bases of the record change. */
+    bool packed;
+    /** true if no segment contains an insertion or a deletion, i.e. packed_bases is a gap free image of the read. */
+    bool indel_free;
 
     /** merges the single end DNA sequences to super reads. Partly also used by mergeAlignmentRecordsMixed and mergeAlignmentRecordsPaired. i = cigar of ith sequence (1st or 2nd) of AlignmentRecord "this", j = cigar of jth sequence ((1st or 2nd)) of AlignmentRecord "ar". */
     void mergeAlignmentRecordsSingle(const AlignmentRecord& ar, int i, int j);
@@ -81,10 +95,17 @@ private:
     void mergeAlignmentRecordsPaired(const AlignmentRecord& ar);
     /** merges two mixed reads (one single end and one paired end): "this" AlignmentRecord and AlignmentRecord "ar". */
     void mergeAlignmentRecordsMixed(const AlignmentRecord& ar);
+    /** merges the sequence and the read names of AlignmentRecord "ar" into "this" AlignmentRecord. Callers have to update cov_pos afterwards. */
+    void mergeWith(const AlignmentRecord& ar);
 public:
-    AlignmentRecord(){}
+    AlignmentRecord() : readFamilies(nullptr), packed_start(0), packed(false), indel_free(false) {}
     AlignmentRecord(const BamTools::BamAlignment& bam_alignment, int id, std::vector<std::string>* readNameMap);
     AlignmentRecord(std::unique_ptr<std::vector<const AlignmentRecord*>>& alignments,unsigned int clique_id);
+    /** merges the first count single end alignments in one pass over the reference columns, with the same result
+     *  as folding them in with mergeWith and updating cov_pos. "this" has to hold the first alignment, as at the
+     *  start of the merging constructor. Returns false without changing "this" if an alignment has indels the
+     *  pairwise merge would not handle in the same way; the caller then has to fold. */
+    bool pileupMergeSingle(const std::vector<const AlignmentRecord*>& alignments, size_t count);
     /** creates DNA sequence and Cigar string for the non-overlapping areas of the two overlapping Alignment Records (helper functions for merging DNA Sequences to create combined Alignment Record). */
     void noOverlapMerge(std::string& dna, std::string& qualities, std::string& cigar_unrolled_new, int& c_pos, int& q_pos, int& ref_pos, int i) const;
     /** creates DNA sequence and Cigar string for the non-overlapping areas of the two overlapping sequences while reading in BAM file (helper function for getMergedDnaSequence). */
@@ -121,6 +142,7 @@ public:
 	int getEnd1() const;
 	int getEnd2() const;
 	std::string getName() const;
+	void setName(const std::string& name);
 	int getStart1() const;
 	int getStart2() const;
 	const std::vector<BamTools::CigarOp>& getCigar1() const;
@@ -150,8 +172,37 @@ public:
     }
 
     unsigned int getReadCount() const { return readNames.size(); }
+    /** Returns the number of distinct molecules (UMI families) among the reads of this record. */
+    unsigned int getMoleculeCount() const;
+    /** Returns the fingerprint of the set of original reads this record stands for. */
+    read_set_fingerprint_t getFingerprint() const;
+    /** Returns a hash of the positions, sequences, qualities and cigar strings of this record. */
+    uint64_t getContentHash() const;
+    const std::string& getUmi() const { return umi; }
+    void setUmi(const std::string& umi) { this->umi = umi; }
+    /** computes the packed 2-bit representation of the covered bases and whether the record is free of indels.
+        Records are not packed on construction, since only the mismatch filter and pruneContainedReads need it;
+        countMismatches and isIndelFree are only valid after calling this. Records that are already packed
+        are left as they are, so carried and singleton super reads are packed only once. */
+    void packBases();
+    bool isIndelFree() const { return indel_free; }
+    /** counts the positions at which both reads carry a different base using the packed 2-bit representation,
+        the number of positions covered by both reads is stored in overlap. */
+    unsigned int countMismatches(const AlignmentRecord& ar, unsigned int& overlap) const;
     /** calculates standard deviation of reads. */
     friend double setProbabilities(std::deque<AlignmentRecord*>& reads);
+    /** merges reads with identical positions, cigar strings and sequences into the first of them, which then holds
+        all their read names. Qualities are compared in bins of quality_bin_width phred scores. Returns the number of
+        removed records. */
+    friend size_t collapseDuplicates(std::deque<AlignmentRecord*>& reads, int quality_bin_width);
+    /** folds reads with the same UMI and mapping position into one consensus record per family. read_families
+        receives the family of every read id and is referenced by all records afterwards, so it has to outlive them.
+        Returns the number of removed records. */
+    friend size_t collapseUmiFamilies(std::deque<AlignmentRecord*>& reads, std::vector<int>& read_families);
+    /** folds every gap free read that lies within another gap free read and agrees with it on all shared positions
+        into the containing read that ends first. reads may be in any order; the remaining reads keep it. Returns the
+        number of removed records. */
+    friend size_t pruneContainedReads(std::deque<AlignmentRecord*>& reads);
     /** prints the final super reads in fasta format. */
     friend void printReads(std::ostream& output, std::deque<AlignmentRecord*>& reads, int doc_haplotypes);
     /** prints the final super reads in GFF format. */
@@ -2,45 +2,84 @@
 #include <boost/unordered_set.hpp>
 #include <boost/dynamic_bitset.hpp>
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 // using namespace boost;
 using namespace std;
 
+namespace {
+
+/** top-level vertices with at least this many candidates are split into one task per branch. */
+const size_t BRANCH_SPLIT_MIN = 64;
+
+const size_t bits_per_word = 64;
+
+bool none(const uint64_t* set, size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        if (set[w] != 0) return false;
+    }
+    return true;
+}
+
+size_t count(const uint64_t* set, size_t words) {
+    size_t n = 0;
+    for (size_t w = 0; w < words; ++w) n += __builtin_popcountll(set[w]);
+    return n;
+}
+
+bool test(const uint64_t* set, size_t i) {
+    return (set[i / bits_per_word] >> (i % bits_per_word)) & 1;
+}
+
+}
+
 BronKerbosch::BronKerbosch(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, LogWriter* lw)
 : CliqueFinder(edge_calculator, clique_collector), alignments_(), lw(lw) {
-    order_ = nullptr;
-    vertices_ = nullptr;
-    degree_map_ = nullptr;
-    actives_ = nullptr;
-    vertices_as_lists_ = nullptr;
+    workers = nullptr;
+    streaming = false;
 }
 
 BronKerbosch::~BronKerbosch() {
-    if (cliques != nullptr) {
+    if (initialized) {
         finish();
     }
     for (auto&& alignment : alignments_) {
-        delete alignment;
+        clique_collector.release(alignment);
     }
-    delete order_;
-    delete vertices_;
+    delete workers;
+}
+
+void BronKerbosch::setThreads(unsigned int threads) {
+    delete workers;
+    workers = (threads > 1) ? new WorkerGroup(threads - 1) : nullptr;
+}
+
+void BronKerbosch::setStreaming(bool streaming) {
+    assert(not initialized);
+    this->streaming = streaming;
 }
 
 void BronKerbosch::initialize() {
     assert(not initialized);
 
-    cliques = new clique_list_t();
     for (auto&& alignment : alignments_) {
-        delete alignment;
+        clique_collector.release(alignment);
     }
     alignments_.clear();
-    delete order_;
-    delete vertices_;
-    order_ = nullptr;
-    vertices_ = nullptr;
-    degree_map_ = new degree_map_t();
-    actives_ = new list<adjacency_list_t*>();
-    vertices_as_lists_ = new vector<adjacency_list_t*>();
+    order_.clear();
+    edges_.clear();
+    adjacency_offsets_.clear();
+    adjacency_.clear();
+    components_.clear();
+    actives_.clear();
+    retired_.clear();
+    neighbours_.clear();
+    component_parent_.clear();
+    component_actives_.clear();
+    component_next_.clear();
+    retire_rank_.clear();
+    retired_count_ = 0;
 
   	alignment_count = 0;
     next_id = 0;
@@ -52,177 +91,551 @@ void BronKerbosch::initialize() {
 void BronKerbosch::finish() {
     assert(initialized);
 
-    degeneracy_order();
-
-    alignment_set_t R(alignment_count);
-    alignment_set_t P(alignment_count);
-    P.flip();
-    alignment_set_t X(alignment_count);
-
-    for (auto&& i : *order_) {
+    if (streaming) {
+        // all remaining vertices retire, which completes all remaining components
+        vector<size_t> completed;
+        for (auto&& v : actives_) {
+            retire(v, completed);
+        }
+        actives_.clear();
+        for (auto&& root : completed) {
+            enumerate_component(root);
+        }
+        initialized = false;
+        return;
+    }
 
-        bronkerbosch(R.set(i), P & (*vertices_)[i], X & (*vertices_)[i]);
+    build_adjacency();
+    vector<size_t> sequence(retired_);
+    sequence.insert(sequence.end(), actives_.begin(), actives_.end());
+    retired_.clear();
+    actives_.clear();
+    degeneracy_order(adjacency_offsets_, adjacency_, sequence, order_);
+    split_components();
+
+    // Report cliques in the order of the global top-level loop, so that the result
+    // does not depend on the decomposition or on the scheduling of the components.
+    enumerate_and_report();
+    initialized = false;
+}
 
-        R.reset(i);
-        P.reset(i);
-        X.set(i);
+void BronKerbosch::enumerate_and_report() {
+    if (workers != nullptr) {
+        enumerate_parallel();
+    } else {
+        search_stack_t stack;
+        for (auto&& component : components_) {
+            enumerate(component, stack);
+        }
+    }
+    for (auto&& t : top_level_) {
+        for (auto&& clique : components_[t.first].found[t.second]) {
+            clique_collector.add(unique_ptr<Clique>(clique));
+        }
     }
+    components_.clear();
+    top_level_.clear();
+}
 
-    for (auto&& clique : *cliques) {
-        clique_collector.add(unique_ptr<Clique>(clique));
+void BronKerbosch::build_rows(component_t& component, const vector<size_t>& offsets, const vector<size_t>& adjacency) {
+    size_t n = component.members.size();
+    component.words = (n + bits_per_word - 1) / bits_per_word;
+    component.adjacency.assign(n * component.words, 0);
+    for (size_t j = 0; j < n; ++j) {
+        uint64_t* row = &component.adjacency[j * component.words];
+        for (size_t k = offsets[j]; k < offsets[j + 1]; ++k) {
+            size_t w = adjacency[k];
+            row[w / bits_per_word] |= (uint64_t)1 << (w % bits_per_word);
+        }
     }
-    delete cliques;
-    cliques = nullptr;
-    initialized = false;
+    component.found.assign(n, vector<Clique*>());
 }
 
-void BronKerbosch::degeneracy_order() {
+size_t BronKerbosch::find_component(size_t v) {
+    while (component_parent_[v] != v) {
+        component_parent_[v] = component_parent_[component_parent_[v]];
+        v = component_parent_[v];
+    }
+    return v;
+}
 
-    // Move all still active vertices into the degree map
-    for (auto it = actives_->begin(); it != actives_->end();) {
-        list<adjacency_list_t*>::size_type ind = (*it)->second.size();
+void BronKerbosch::join_components(size_t v, size_t w) {
+    v = find_component(v);
+    w = find_component(w);
+    if (v == w) return;
+    component_parent_[w] = v;
+    component_actives_[v] += component_actives_[w];
+    // splice the circular member lists
+    swap(component_next_[v], component_next_[w]);
+}
 
-        if(degree_map_->count(ind) == 0) {           
-            degree_map_->emplace(ind, list<adjacency_list_t*>(1, *it) );
-	//	degree_map_->insert(std::pair<std::list<adjacency_list_t*>::size_type, std::list<adjacency_list_t*>>(ind,list<adjacency_list_t*>(1, *it)));
-	
+void BronKerbosch::retire(size_t v, vector<size_t>& completed) {
+    retire_rank_[v] = retired_count_++;
+    size_t root = find_component(v);
+    if (--component_actives_[root] == 0) {
+        completed.push_back(root);
+    }
+}
 
-        } else {
-            degree_map_->at(ind).push_back(*it);
+void BronKerbosch::enumerate_component(size_t root) {
+    components_.assign(1, component_t());
+    component_t& component = components_.back();
+    size_t v = root;
+    do {
+        component.members.push_back(v);
+        v = component_next_[v];
+    } while (v != root);
+    sort(component.members.begin(), component.members.end());
+    size_t n = component.members.size();
+
+    // adjacency in local indices, neighbours in the order the edges were found
+    auto local = [&](size_t global) {
+        return size_t(lower_bound(component.members.begin(), component.members.end(), global) - component.members.begin());
+    };
+    vector<size_t> offsets(n + 1, 0);
+    vector<size_t> adjacency;
+    for (size_t j = 0; j < n; ++j) {
+        for (auto&& w : neighbours_[component.members[j]]) {
+            adjacency.push_back(local(w));
         }
-        
-        it = actives_->erase(it);
+        offsets[j + 1] = adjacency.size();
+    }
+    vector<size_t> sequence(n);
+    for (size_t j = 0; j < n; ++j) sequence[j] = j;
+    sort(sequence.begin(), sequence.end(), [&](size_t j1, size_t j2) {
+        return retire_rank_[component.members[j1]] < retire_rank_[component.members[j2]];
+    });
+
+    component.degeneracy = degeneracy_order(offsets, adjacency, sequence, component.order);
+    component.position.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        component.position[component.order[k]] = k;
+        top_level_.emplace_back(0, component.order[k]);
     }
+    build_rows(component, offsets, adjacency);
+    vector<size_t> members(component.members);
 
-    order_ = new list<size_t>();
-    vertices_ = new vector<alignment_set_t>(alignment_count, alignment_set_t(alignment_count));
+    enumerate_and_report();
 
-    while (not degree_map_->empty()) {
-        auto it = degree_map_->begin();
+    // the collector has copied what it needs from the alignments
+    for (auto&& global : members) {
+        clique_collector.release(alignments_[global]);
+        alignments_[global] = nullptr;
+        vector<size_t>().swap(neighbours_[global]);
+    }
+}
 
-        if (it->second.empty()) {
-            degree_map_->erase(it);
-            continue;
+void BronKerbosch::split_components() {
+    const size_t none = numeric_limits<size_t>::max();
+    vector<size_t> component_of(alignment_count, none);
+    vector<size_t> local_index(alignment_count);
+    vector<size_t> stack;
+
+    components_.clear();
+    top_level_.clear();
+    for (size_t v = 0; v < alignment_count; ++v) {
+        if (component_of[v] != none) continue;
+        size_t c = components_.size();
+        components_.push_back(component_t());
+        component_t& component = components_.back();
+        component_of[v] = c;
+        stack.push_back(v);
+        while (not stack.empty()) {
+            size_t u = stack.back();
+            stack.pop_back();
+            component.members.push_back(u);
+            for (size_t k = adjacency_offsets_[u]; k < adjacency_offsets_[u+1]; ++k) {
+                size_t w = adjacency_[k];
+                if (component_of[w] == none) {
+                    component_of[w] = c;
+                    stack.push_back(w);
+                }
+            }
         }
-        
-        adjacency_list_t* list_vertex = it->second.front();
-        it->second.pop_front();
-
-        // Update degree map
-        for (auto&& index : list_vertex->second) {
-            adjacency_list_t* companion = (*vertices_as_lists_)[index];
-            list<adjacency_list_t*>::size_type s = companion->second.size();
+        // keep local indices ascending in the global index, so that bitset scans
+        // visit vertices in the same order as on the whole graph
+        sort(component.members.begin(), component.members.end());
+        for (size_t j = 0; j < component.members.size(); ++j) {
+            local_index[component.members[j]] = j;
+        }
+        vector<size_t> offsets(1, 0);
+        vector<size_t> adjacency;
+        for (auto&& u : component.members) {
+            for (size_t k = adjacency_offsets_[u]; k < adjacency_offsets_[u+1]; ++k) {
+                adjacency.push_back(local_index[adjacency_[k]]);
+            }
+            offsets.push_back(adjacency.size());
+        }
+        build_rows(component, offsets, adjacency);
+        component.position.resize(component.members.size());
+    }
+    for (auto&& i : order_) {
+        component_t& component = components_[component_of[i]];
+        component.position[local_index[i]] = component.order.size();
+        component.order.push_back(local_index[i]);
+        top_level_.emplace_back(component_of[i], local_index[i]);
+    }
+    for (auto&& component : components_) {
+        component.degeneracy = 0;
+        for (size_t j = 0; j < component.members.size(); ++j) {
+            size_t later = 0;
+            for (size_t w = 0; w < component.words; ++w) {
+                for (uint64_t bits = component.row(j)[w]; bits != 0; bits &= bits - 1) {
+                    if (component.position[w * bits_per_word + __builtin_ctzll(bits)] > component.position[j]) ++later;
+                }
+            }
+            component.degeneracy = max(component.degeneracy, later);
+        }
+    }
+}
 
-            (*vertices_)[list_vertex->first].set(companion->first);
-            (*vertices_)[companion->first].set(list_vertex->first);
+void BronKerbosch::prepare_stack(const component_t& component, search_stack_t& stack) const {
+    // |P| is at most the degeneracy below the top level and shrinks with every level
+    size_t frames = component.degeneracy + 3;
+    if (stack.frames.size() < frames * 3 * component.words) {
+        stack.frames.resize(frames * 3 * component.words);
+    }
+    stack.R.reserve(component.degeneracy + 2);
+    stack.R.clear();
+}
 
-            companion->second.remove(list_vertex->first);
+void BronKerbosch::enumerate(component_t& component, search_stack_t& stack) {
+    size_t n = component.members.size();
+    size_t words = component.words;
+    prepare_stack(component, stack);
+
+    // frame 0 holds P and X of the top-level loop
+    uint64_t* P = stack.P(0, words);
+    uint64_t* X = stack.X(0, words);
+    fill(P, P + words, ~(uint64_t)0);
+    if (n % bits_per_word != 0) P[words - 1] = ((uint64_t)1 << (n % bits_per_word)) - 1;
+    fill(X, X + words, 0);
+    uint64_t* P1 = stack.P(1, words);
+    uint64_t* X1 = stack.X(1, words);
+
+    for (auto&& i : component.order) {
+        const uint64_t* N = component.row(i);
+        for (size_t w = 0; w < words; ++w) {
+            P1[w] = P[w] & N[w];
+            X1[w] = X[w] & N[w];
+        }
+        stack.R.push_back(i);
+        bronkerbosch(component, stack, 1, component.found[i]);
+        stack.R.pop_back();
 
-            degree_map_->at(s).remove(companion);
+        P[i / bits_per_word] &= ~((uint64_t)1 << (i % bits_per_word));
+        X[i / bits_per_word] |= (uint64_t)1 << (i % bits_per_word);
+    }
+}
 
-            if (degree_map_->count(s-1) == 0) {
-                degree_map_->emplace(s-1, list<adjacency_list_t*>(1, companion) );                
-		//degree_map_->insert(std::pair<std::list<adjacency_list_t*>::size_type, std::list<adjacency_list_t*>>(s-1, list<adjacency_list_t*>(1, companion)));
+void BronKerbosch::top_level_sets(const component_t& component, size_t v, search_stack_t& stack) const {
+    size_t words = component.words;
+    uint64_t* P = stack.P(1, words);
+    uint64_t* X = stack.X(1, words);
+    const uint64_t* N = component.row(v);
+    for (size_t w = 0; w < words; ++w) {
+        P[w] = N[w];
+        X[w] = N[w];
+        for (uint64_t bits = N[w]; bits != 0; bits &= bits - 1) {
+            size_t j = w * bits_per_word + __builtin_ctzll(bits);
+            uint64_t bit = (uint64_t)1 << (j % bits_per_word);
+            if (component.position[j] < component.position[v]) {
+                P[w] &= ~bit;
             } else {
-                degree_map_->at(s-1).push_front(companion);
+                X[w] &= ~bit;
             }
         }
-        order_->push_back(list_vertex->first);
-
-        delete list_vertex;
     }
+    stack.R.clear();
+    stack.R.push_back(v);
+}
 
-    delete degree_map_;
-    delete actives_;
-    delete vertices_as_lists_;
+void BronKerbosch::enumerate_parallel() {
+    // Every task borrows a stack; there are never more in use than threads.
+    vector<unique_ptr<search_stack_t>> stacks;
+    vector<search_stack_t*> free_stacks;
+    pthread_mutex_t stacks_mutex;
+    pthread_mutex_init(&stacks_mutex, 0);
+    auto acquire = [&]() {
+        pthread_mutex_lock(&stacks_mutex);
+        if (free_stacks.empty()) {
+            stacks.emplace_back(new search_stack_t());
+            free_stacks.push_back(stacks.back().get());
+        }
+        search_stack_t* stack = free_stacks.back();
+        free_stacks.pop_back();
+        pthread_mutex_unlock(&stacks_mutex);
+        return stack;
+    };
+    auto release = [&](search_stack_t* stack) {
+        pthread_mutex_lock(&stacks_mutex);
+        free_stacks.push_back(stack);
+        pthread_mutex_unlock(&stacks_mutex);
+    };
+
+    // Phase 1: one task per vertex of the top-level loop. Vertices with many candidates
+    // only compute their branches, which become separate tasks in phase 2.
+    vector<vector<size_t>> branches(top_level_.size());
+    workers->run(top_level_.size(), [&](size_t t) {
+        component_t& component = components_[top_level_[t].first];
+        size_t v = top_level_[t].second;
+        size_t words = component.words;
+        search_stack_t* stack = acquire();
+        prepare_stack(component, *stack);
+        top_level_sets(component, v, *stack);
+        const uint64_t* P = stack->P(1, words);
+        if (count(P, words) < BRANCH_SPLIT_MIN) {
+            bronkerbosch(component, *stack, 1, component.found[v]);
+        } else {
+            const uint64_t* N = component.row(find_pivot(component, P, stack->X(1, words)));
+            for (size_t w = 0; w < words; ++w) {
+                for (uint64_t bits = P[w] & ~N[w]; bits != 0; bits &= bits - 1) {
+                    branches[t].push_back(w * bits_per_word + __builtin_ctzll(bits));
+                }
+            }
+        }
+        release(stack);
+    });
+
+    // Phase 2: branch k of a split vertex starts from the sets the serial loop
+    // has after its first k branches.
+    vector<pair<size_t, size_t>> branch_tasks;
+    for (size_t t = 0; t < branches.size(); ++t) {
+        for (size_t k = 0; k < branches[t].size(); ++k) {
+            branch_tasks.emplace_back(t, k);
+        }
+    }
+    vector<vector<Clique*>> found(branch_tasks.size());
+    if (not branch_tasks.empty()) workers->run(branch_tasks.size(), [&](size_t b) {
+        size_t t = branch_tasks[b].first;
+        size_t k = branch_tasks[b].second;
+        const component_t& component = components_[top_level_[t].first];
+        size_t words = component.words;
+        search_stack_t* stack = acquire();
+        prepare_stack(component, *stack);
+        top_level_sets(component, top_level_[t].second, *stack);
+        uint64_t* P = stack->P(1, words);
+        uint64_t* X = stack->X(1, words);
+        for (size_t j = 0; j < k; ++j) {
+            size_t i = branches[t][j];
+            P[i / bits_per_word] &= ~((uint64_t)1 << (i % bits_per_word));
+            X[i / bits_per_word] |= (uint64_t)1 << (i % bits_per_word);
+        }
+        size_t i = branches[t][k];
+        const uint64_t* N = component.row(i);
+        uint64_t* P2 = stack->P(2, words);
+        uint64_t* X2 = stack->X(2, words);
+        for (size_t w = 0; w < words; ++w) {
+            P2[w] = P[w] & N[w];
+            X2[w] = X[w] & N[w];
+        }
+        stack->R.push_back(i);
+        bronkerbosch(component, *stack, 2, found[b]);
+        release(stack);
+    });
+    pthread_mutex_destroy(&stacks_mutex);
+
+    // branch tasks of a vertex are consecutive and in branch order
+    for (size_t b = 0; b < branch_tasks.size(); ++b) {
+        const pair<size_t, size_t>& t = top_level_[branch_tasks[b].first];
+        vector<Clique*>& out = components_[t.first].found[t.second];
+        out.insert(out.end(), found[b].begin(), found[b].end());
+    }
 }
 
-alignment_set_t::size_type BronKerbosch::find_pivot(const alignment_set_t& P, const alignment_set_t& X) {
-    alignment_set_t unit = P | X;
-    alignment_set_t::size_type max_size = 0;
-    alignment_set_t::size_type index = unit.find_first();
+void BronKerbosch::build_adjacency() {
+    adjacency_offsets_.assign(alignment_count + 1, 0);
+    for (auto&& edge : edges_) {
+        adjacency_offsets_[edge.first + 1] += 1;
+        adjacency_offsets_[edge.second + 1] += 1;
+    }
+    for (size_t v = 0; v < alignment_count; ++v) {
+        adjacency_offsets_[v + 1] += adjacency_offsets_[v];
+    }
+    adjacency_.resize(adjacency_offsets_[alignment_count]);
+    vector<size_t> fill(adjacency_offsets_.begin(), adjacency_offsets_.end() - 1);
+    for (auto&& edge : edges_) {
+        adjacency_[fill[edge.first]++] = edge.second;
+        adjacency_[fill[edge.second]++] = edge.first;
+    }
+    vector<pair<size_t, size_t>>().swap(edges_);
+}
 
-    for(auto i = unit.find_next(index); i != alignment_set_t::npos; i = unit.find_next(i)) {
-        auto new_size = (P & (*vertices_)[i]).count();        
+size_t BronKerbosch::degeneracy_order(const vector<size_t>& offsets, const vector<size_t>& adjacency, const vector<size_t>& sequence, vector<size_t>& order) {
+    const size_t none = numeric_limits<size_t>::max();
+    size_t n = sequence.size();
+
+    // Vertices are kept in one doubly linked list per degree. Retired vertices enter
+    // at the back, vertices whose degree dropped at the front, and the next vertex is
+    // taken from the front of the lowest non-empty list.
+    vector<size_t> degree(n);
+    size_t max_degree = 0;
+    for (size_t v = 0; v < n; ++v) {
+        degree[v] = offsets[v + 1] - offsets[v];
+        max_degree = max(max_degree, degree[v]);
+    }
+    vector<size_t> head(max_degree + 1, none);
+    vector<size_t> tail(max_degree + 1, none);
+    vector<size_t> prev(n, none);
+    vector<size_t> next(n, none);
+
+    auto unlink = [&](size_t v) {
+        size_t d = degree[v];
+        if (prev[v] != none) next[prev[v]] = next[v]; else head[d] = next[v];
+        if (next[v] != none) prev[next[v]] = prev[v]; else tail[d] = prev[v];
+    };
+    auto push_back = [&](size_t v) {
+        size_t d = degree[v];
+        prev[v] = tail[d];
+        next[v] = none;
+        if (tail[d] != none) next[tail[d]] = v; else head[d] = v;
+        tail[d] = v;
+    };
+    auto push_front = [&](size_t v) {
+        size_t d = degree[v];
+        prev[v] = none;
+        next[v] = head[d];
+        if (head[d] != none) prev[head[d]] = v; else tail[d] = v;
+        head[d] = v;
+    };
+
+    for (auto&& v : sequence) push_back(v);
+
+    vector<char> removed(n, 0);
+    size_t min_degree = 0;
+    size_t degeneracy = 0;
+    order.clear();
+    order.reserve(n);
+
+    for (size_t k = 0; k < n; ++k) {
+        while (head[min_degree] == none) ++min_degree;
+        size_t v = head[min_degree];
+        unlink(v);
+        removed[v] = 1;
+
+        // Update degrees of the remaining neighbours
+        for (size_t j = offsets[v]; j < offsets[v + 1]; ++j) {
+            size_t companion = adjacency[j];
+            if (removed[companion]) continue;
+            unlink(companion);
+            degree[companion] -= 1;
+            push_front(companion);
+            min_degree = min(min_degree, degree[companion]);
+        }
+        degeneracy = max(degeneracy, degree[v]);
+        order.push_back(v);
+    }
+    return degeneracy;
+}
 
-        if ( new_size > max_size ) {
-            max_size = new_size;
-            index = i;
+size_t BronKerbosch::find_pivot(const component_t& component, const uint64_t* P, const uint64_t* X) const {
+    size_t words = component.words;
+    // only the words in which P has bits can contribute to |P & N(i)|
+    size_t begin = 0;
+    while (begin < words && P[begin] == 0) ++begin;
+    size_t end = words;
+    while (end > begin && P[end - 1] == 0) --end;
+
+    size_t max_size = 0;
+    size_t index = npos;
+
+    for (size_t w = 0; w < words; ++w) {
+        for (uint64_t bits = P[w] | X[w]; bits != 0; bits &= bits - 1) {
+            size_t i = w * bits_per_word + __builtin_ctzll(bits);
+            if (index == npos) {
+                index = i;
+                continue;
+            }
+            const uint64_t* N = component.row(i);
+            size_t new_size = 0;
+            for (size_t v = begin; v < end; ++v) {
+                new_size += __builtin_popcountll(P[v] & N[v]);
+            }
+            if ( new_size > max_size ) {
+                max_size = new_size;
+                index = i;
+            }
         }
     }
 
-    assert(index != alignment_set_t::npos);
+    assert(index != npos);
 
     return index;
 }
 
-void BronKerbosch::bronkerbosch(alignment_set_t R, alignment_set_t P, alignment_set_t X) {
-    assert(cliquesistent(R, P, X));
-
-    if (P.none()) {
-        if (X.none()) {
-            unique_ptr<alignment_set_t> ptr(new alignment_set_t(R));
-            cliques->push_back(new Clique(*this,  ptr));
+void BronKerbosch::bronkerbosch(const component_t& component, search_stack_t& stack, size_t depth, vector<Clique*>& out) {
+    size_t words = component.words;
+    uint64_t* P = stack.P(depth, words);
+    uint64_t* X = stack.X(depth, words);
+    assert(cliquesistent(component, stack.R, P, X));
+
+    if (none(P, words)) {
+        if (none(X, words)) {
+            // translate local indices back to the whole graph
+            auto bounds = minmax_element(stack.R.begin(), stack.R.end());
+            WindowedBitset members(component.members[*bounds.first], component.members[*bounds.second]);
+            for (auto&& j : stack.R) {
+                members.set(component.members[j]);
+            }
+            out.push_back(new Clique(*this, members));
         }
         return;
     }
 
-    alignment_set_t::size_type pivot = find_pivot(P, X);
-    alignment_set_t comp = P - (*vertices_)[pivot];
-
-    for (auto i = comp.find_first(); i != alignment_set_t::npos; i = comp.find_next(i)) {
-        bronkerbosch(R.set(i), P & (*vertices_)[i], X & (*vertices_)[i]);
+    const uint64_t* pivot = component.row(find_pivot(component, P, X));
+    uint64_t* comp = stack.branches(depth, words);
+    for (size_t w = 0; w < words; ++w) {
+        comp[w] = P[w] & ~pivot[w];
+    }
+    assert((depth + 2) * 3 * words <= stack.frames.size());
+    uint64_t* P1 = stack.P(depth + 1, words);
+    uint64_t* X1 = stack.X(depth + 1, words);
+
+    for (size_t w = 0; w < words; ++w) {
+        for (uint64_t bits = comp[w]; bits != 0; bits &= bits - 1) {
+            size_t i = w * bits_per_word + __builtin_ctzll(bits);
+            const uint64_t* N = component.row(i);
+            for (size_t v = 0; v < words; ++v) {
+                P1[v] = P[v] & N[v];
+                X1[v] = X[v] & N[v];
+            }
+            stack.R.push_back(i);
+            bronkerbosch(component, stack, depth + 1, out);
+            stack.R.pop_back();
 
-        R.reset(i);
-        P.reset(i);
-        X.set(i);
+            P[w] &= ~(bits & -bits);
+            X[w] |= bits & -bits;
+        }
     }
 }
 
 /*
  * Checks the invariant of the BronKerbosch algorithm
  */
-bool BronKerbosch::cliquesistent(const alignment_set_t& R, const alignment_set_t& P, const alignment_set_t& X) {
-    auto i = R.find_first();
-    alignment_set_t intersect((*vertices_)[i]);
-    intersect.set(i);
-
-    for (i=R.find_next(i); i != alignment_set_t::npos; i = R.find_next(i)) {
-        alignment_set_t tmp((*vertices_)[i]);
-        tmp.set(i);
-
-        intersect &= tmp;
-    }
-    if (not R.is_subset_of(intersect)) {
-        cerr << "R - intersect:";
-        printSet(cerr, R - intersect);
-        cerr << "vertices in R:" << endl;
-        for (auto i=R.find_first(); i != alignment_set_t::npos; i = R.find_next(i)) {
-            cerr << i << ":";
-            printSet(cerr, (*vertices_)[i]);
-        }
-        return false;
-    }
-    if (not (P | X).is_subset_of(intersect)) {
-        cerr << "(P | X) - intersect:";
-        printSet(cerr, (P | X) - intersect);
-        cerr << "vertices in P:" << endl;
-        for (auto i=P.find_first(); i != alignment_set_t::npos; i = P.find_next(i)) {
-            cerr << i << ":";
-            printSet(cerr, (*vertices_)[i]);
+bool BronKerbosch::cliquesistent(const component_t& component, const vector<size_t>& R, const uint64_t* P, const uint64_t* X) const {
+    for (auto&& i : R) {
+        for (auto&& j : R) {
+            if (i != j && not test(component.row(i), j)) {
+                cerr << "R contains non-adjacent vertices " << i << " and " << j << endl;
+                return false;
+            }
         }
-        cerr << "vertices in X:" << endl;
-        for (auto i=X.find_first(); i != alignment_set_t::npos; i = X.find_next(i)) {
-            cerr << i << ":";
-            printSet(cerr, (*vertices_)[i]);
+    }
+    for (size_t w = 0; w < component.words; ++w) {
+        for (uint64_t bits = P[w] | X[w]; bits != 0; bits &= bits - 1) {
+            size_t j = w * bits_per_word + __builtin_ctzll(bits);
+            for (auto&& i : R) {
+                if (i != j && not test(component.row(i), j)) {
+                    cerr << "vertex " << j << " in P | X is not adjacent to " << i << " in R" << endl;
+                    return false;
+                }
+            }
         }
-
-        return false;
     }
     return true;
 }
 
-void BronKerbosch::printSet(std::ostream& os, alignment_set_t set) {
+void BronKerbosch::printSet(std::ostream& os, alignment_set_t set) const {
     for (auto j = set.find_first(); j != alignment_set_t::npos; j = set.find_next(j)) {
         os << " " << j;
     }
@@ -242,17 +655,19 @@ void BronKerbosch::printReads(std::ostream& os, alignment_set_t set) {
 void BronKerbosch::printEdges(std::string filename) {
     ofstream edgefile(filename, ofstream::out);
 
-    for(unsigned int i = 0; i < alignment_count; i++) {
-        alignment_set_t node = (*vertices_)[i];
+    for(unsigned int i = 0; i + 1 < adjacency_offsets_.size(); i++) {
+        vector<size_t> node(adjacency_.begin() + adjacency_offsets_[i], adjacency_.begin() + adjacency_offsets_[i+1]);
+        sort(node.begin(), node.end());
         edgefile << i << ":" << alignments_[i]->getName() << " ->";
-        
-        printSet(edgefile, node);
+        for (auto&& j : node) {
+            edgefile << " " << j;
+        }
+        edgefile << endl;
     }
 }
 
 void BronKerbosch::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, int& edgecounter) {
 	assert(alignment_autoptr.get() != nullptr);
-	assert(cliques!=nullptr);
     assert(initialized);
 
 	alignment_id_t id = next_id++;
@@ -261,27 +676,29 @@ void BronKerbosch::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_auto
 
 	size_t index = alignment_count++;
 	alignments_.push_back(alignment);
+    if (streaming) {
+        neighbours_.emplace_back();
+        component_parent_.push_back(index);
+        component_actives_.push_back(1);
+        component_next_.push_back(index);
+        retire_rank_.push_back(0);
+    }
+    vector<size_t> completed;
 
-    adjacency_list_t* vertex = new adjacency_list_t(index, list<size_t>());
-
-    vertices_as_lists_->push_back(vertex);
-
-    for (auto it = actives_->begin(); it != actives_->end();) {
-        AlignmentRecord* alignment2 = alignments_[(*it)->first];
+    size_t kept = 0;
+    for (size_t k = 0; k < actives_.size(); ++k) {
+        size_t index2 = actives_[k];
+        AlignmentRecord* alignment2 = alignments_[index2];
 
         if (alignment->getIntervalStart() > alignment2->getIntervalEnd()) {
-            list<adjacency_list_t*>::size_type ind = (*it)->second.size();
-
-            if(degree_map_->count(ind) == 0) {           
-                degree_map_->emplace(ind, list<adjacency_list_t*>(1, *it) );
-//		degree_map_->insert(std::pair<std::list<adjacency_list_t*>::size_type, std::list<adjacency_list_t*>> (ind, list<adjacency_list_t*>(1, *it)));
+            if (streaming) {
+                retire(index2, completed);
             } else {
-                degree_map_->at(ind).push_back(*it);
+                retired_.push_back(index2);
             }
-            
-            it = actives_->erase(it);
             continue;
         }
+        actives_[kept++] = index2;
 
         if(edge_calculator.edgeBetween(*alignment, *alignment2) ) {
 
@@ -291,17 +708,27 @@ void BronKerbosch::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_auto
                 }
             }
 
-            // Draw edge between current alignment and old alignment in vert
-            get<1>(*vertex).push_back((*it)->first);
-            get<1>(**it).push_back(vertex->first);
+            // Draw edge between current alignment and old alignment
+            if (streaming) {
+                neighbours_[index].push_back(index2);
+                neighbours_[index2].push_back(index);
+                join_components(index, index2);
+            } else {
+                edges_.emplace_back(index, index2);
+            }
 
-            if (lw != nullptr) lw->reportEdge(vertex->first, (*it)->first);
+            if (lw != nullptr) lw->reportEdge(index, index2);
 
             converged = false;
         }
-        it++;
     }
+    actives_.resize(kept);
+
+    actives_.push_back(index);
 
-    actives_->push_back(vertex);
+    // components without active vertices cannot grow any more
+    for (auto&& root : completed) {
+        enumerate_component(root);
+    }
 
 }
@@ -2,37 +2,114 @@
 #define BRONKERBOSCH_H_
 
 #include <vector>
-#include <map>
-#include <list>
+#include <cstdint>
 #include <utility>
 
 #include "CliqueFinder.h"
 #include "LogWriter.h"
+#include "WorkerGroup.h"
 
 class BronKerbosch : public CliqueFinder {
 private:
-    typedef std::pair<size_t, std::list<size_t>> adjacency_list_t;
-    typedef std::map<std::list<adjacency_list_t*>::size_type, std::list<adjacency_list_t*>> degree_map_t;
+    /** connected component of the graph, enumerated on its own with bitsets sized to the component. */
+    typedef struct component_t {
+        /** global indices of the vertices, ascending; position in this vector is the local index. */
+        std::vector<size_t> members;
+        /** local indices in degeneracy order. */
+        std::vector<size_t> order;
+        /** position of each local vertex in order. */
+        std::vector<size_t> position;
+        /** adjacency of the local vertices, one row of words per vertex. */
+        size_t words;
+        std::vector<uint64_t> adjacency;
+        const uint64_t* row(size_t v) const { return &adjacency[v * words]; }
+        /** maximum number of later neighbours of a vertex in order; bounds the recursion depth. */
+        size_t degeneracy;
+        /** cliques found below each local vertex of the top-level loop. */
+        std::vector<std::vector<Clique*>> found;
+    } component_t;
+    /** working memory of the recursion. Every depth owns three word arrays (P, X and
+     *  the branches left to visit), so that the recursion does not allocate. */
+    typedef struct search_stack_t {
+        std::vector<uint64_t> frames;
+        /** current clique as local indices. */
+        std::vector<size_t> R;
+        uint64_t* P(size_t depth, size_t words) { return &frames[depth * 3 * words]; }
+        uint64_t* X(size_t depth, size_t words) { return &frames[(depth * 3 + 1) * words]; }
+        uint64_t* branches(size_t depth, size_t words) { return &frames[(depth * 3 + 2) * words]; }
+    } search_stack_t;
+    static const size_t npos = -1;
 
     std::vector<AlignmentRecord*> alignments_;
-    std::list<size_t>* order_;
-    std::vector<alignment_set_t>* vertices_;
-    degree_map_t* degree_map_;
-    std::list<adjacency_list_t*>* actives_;
-    std::vector<adjacency_list_t*>* vertices_as_lists_;
+    std::vector<size_t> order_;
+    /** edges in the order they were found, turned into adjacency_offsets_/adjacency_ by build_adjacency(). */
+    std::vector<std::pair<size_t, size_t>> edges_;
+    /** compressed adjacency: the neighbours of v are adjacency_[adjacency_offsets_[v]..adjacency_offsets_[v+1]),
+     *  in the order the edges were found. */
+    std::vector<size_t> adjacency_offsets_;
+    std::vector<size_t> adjacency_;
+    std::vector<component_t> components_;
+    /** (component, local vertex) for every vertex in the global degeneracy order. */
+    std::vector<std::pair<size_t, size_t>> top_level_;
+    /** vertices whose interval may still overlap with following alignments. */
+    std::vector<size_t> actives_;
+    /** vertices in the order they left actives_. */
+    std::vector<size_t> retired_;
+    /** in streaming mode, every connected component is enumerated as soon as none of
+     *  its vertices is active any more. The following members track the components
+     *  with a union-find structure; the roots hold the number of active members. */
+    bool streaming;
+    std::vector<std::vector<size_t>> neighbours_;
+    std::vector<size_t> component_parent_;
+    std::vector<size_t> component_actives_;
+    /** circular lists of the members of each component. */
+    std::vector<size_t> component_next_;
+    std::vector<size_t> retire_rank_;
+    size_t retired_count_;
     LogWriter* lw;
+    WorkerGroup* workers;
 
-    void degeneracy_order();
-    void bronkerbosch(alignment_set_t R, alignment_set_t P, alignment_set_t X);
-    alignment_set_t::size_type find_pivot(const alignment_set_t& P, const alignment_set_t& X);
+    void build_adjacency();
+    /** computes the degeneracy order of the graph given by offsets and adjacency with a bucket
+     *  queue in O(n+m); ties are broken by the given sequence of vertices. Returns the degeneracy. */
+    static size_t degeneracy_order(const std::vector<size_t>& offsets, const std::vector<size_t>& adjacency, const std::vector<size_t>& sequence, std::vector<size_t>& order);
+    /** splits the graph into connected components and builds their bitsets. */
+    void split_components();
+    /** sets the bitset rows of a component from its adjacency in local indices. */
+    static void build_rows(component_t& component, const std::vector<size_t>& offsets, const std::vector<size_t>& adjacency);
+    size_t find_component(size_t v);
+    void join_components(size_t v, size_t w);
+    /** marks v as retired and adds the root of its component to completed if that was its last active vertex. */
+    void retire(size_t v, std::vector<size_t>& completed);
+    /** enumerates, reports and frees the finished component with the given root (streaming mode). */
+    void enumerate_component(size_t root);
+    /** enumerates all of components_ and passes the cliques to the collector in top-level order. */
+    void enumerate_and_report();
+    /** runs the top-level loop over the vertices of one component. */
+    void enumerate(component_t& component, search_stack_t& stack);
+    /** runs the subproblems of the top-level loop of all components as independent tasks on workers. */
+    void enumerate_parallel();
+    /** makes the stack large enough for the recursion on the given component. */
+    void prepare_stack(const component_t& component, search_stack_t& stack) const;
+    /** sets R and depth 1 of the stack to the arguments the top-level loop passes for local vertex v. */
+    void top_level_sets(const component_t& component, size_t v, search_stack_t& stack) const;
+    /** recursion on R = stack.R and P, X at the given depth of the stack. */
+    void bronkerbosch(const component_t& component, search_stack_t& stack, size_t depth, std::vector<Clique*>& out);
+    size_t find_pivot(const component_t& component, const uint64_t* P, const uint64_t* X) const;
     void printEdges(std::string filename);
-    void printSet(std::ostream& os, alignment_set_t set);
+    void printSet(std::ostream& os, alignment_set_t set) const;
     void printReads(std::ostream& os, alignment_set_t set);
-    bool cliquesistent(const alignment_set_t& R, const alignment_set_t& P, const alignment_set_t& X);
+    bool cliquesistent(const component_t& component, const std::vector<size_t>& R, const uint64_t* P, const uint64_t* X) const;
 public:
     BronKerbosch(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, LogWriter* lw);
     virtual ~BronKerbosch();
 
+    /** enumerates the subproblems of the top-level loop on the given number of threads. */
+    void setThreads(unsigned int threads);
+    /** enumerates connected components while reading instead of in finish(). Cliques are
+     *  then reported component by component. */
+    void setStreaming(bool streaming);
+
     virtual const AlignmentRecord & getAlignmentByIndex(size_t index) const {
         assert(index<alignment_count);
     	return *(alignments_[index]);
@@ -18,171 +18,254 @@
 
 #include <string.h>
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <boost/unordered_set.hpp>
 #include <boost/dynamic_bitset.hpp>
 #include <ctime>
 #include <map>
+#include <limits>
 #include "CLEVER.h"
+#include "ReadPriorityQueue.h"
 
 using namespace std;
 using namespace boost;
 
-CLEVER::CLEVER(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, LogWriter* lw, unsigned int max_cliques, unsigned int limit_clique_size, unsigned int number_of_reads, bool filter_singletons) : CliqueFinder(edge_calculator, clique_collector), lw(lw), max_cliques(max_cliques), limit_clique_size(limit_clique_size), read_in_cliques(number_of_reads), filter_singletons(filter_singletons) {
-    capacity = alignment_set_t::bits_per_block;
-    alignments = nullptr;
+namespace {
+
+/** below this number of active cliques, the clique update of a new alignment runs on one thread. */
+const size_t PARALLEL_UPDATE_MIN_CLIQUES = 2048;
+
+/** constant size summary of a clique's member set; a.mayBeSubsetOf(b) is
+ *  a necessary condition for a being contained in b. */
+struct SubsetSummary {
+	size_t size;
+	size_t first;
+	size_t last;
+	WindowedBitset::block_type signature;
+	explicit SubsetSummary(const Clique& clique) : size(clique.size()), first(clique.getAlignmentSet().findFirst()), last(clique.getAlignmentSet().findLast()), signature(clique.getAlignmentSet().signature()) {}
+	bool mayBeSubsetOf(const SubsetSummary& other) const {
+		return size <= other.size && first >= other.first && last <= other.last && (signature & ~other.signature) == 0;
+	}
+};
+
+}
+
+CLEVER::CLEVER(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, LogWriter* lw, unsigned int max_cliques, unsigned int limit_clique_size, unsigned int number_of_reads, bool filter_singletons) : CliqueFinder(edge_calculator, clique_collector), lw(lw), max_cliques(max_cliques), limit_clique_size(limit_clique_size), number_of_reads(number_of_reads), filter_singletons(filter_singletons) {
+    window_start = 0;
+    cliques = nullptr;
+    workers = nullptr;
+    max_active_cliques = 0;
+    max_active_bytes = 0;
+    beam_width = 0;
+    bounded = false;
 }
 
 CLEVER::~CLEVER() {
 	if (cliques!=nullptr) {
 		finish();
 	}
+	delete workers;
 }
 
-unsigned int CLEVER::getPriorityRead() {
-    int min_index = std::min_element(this->read_in_cliques.begin(),this->read_in_cliques.end()) - this->read_in_cliques.begin();
-    return min_index;
+void CLEVER::setThreads(unsigned int threads) {
+	delete workers;
+	workers = (threads > 1) ? new WorkerGroup(threads - 1) : nullptr;
 }
 
-Clique* CLEVER::getLargestClique(unsigned int readref){
-    Clique* res_clique = nullptr;
-    auto max = std::numeric_limits<std::size_t>::min();
-    
-    clique_list_t::iterator clique_it = cliques->begin();
-    for (;clique_it!=cliques->end(); ++clique_it) {
-        auto read_names = (*clique_it)->getCliqueReadNamesSet();
-        // first case: clique's set contains read
-        if(read_names.find(readref) != read_names.end() && read_names.size() > max){
-            max = read_names.size();
-            res_clique = *clique_it;
-        }
-    }
-    return res_clique;
+void CLEVER::setActiveCliqueLimit(unsigned int max_active_cliques, unsigned int beam_width, size_t max_active_bytes) {
+	assert((max_active_cliques == 0 && max_active_bytes == 0) || beam_width > 0);
+	this->max_active_cliques = max_active_cliques;
+	this->max_active_bytes = max_active_bytes;
+	this->beam_width = max_active_cliques != 0 ? min(beam_width, max_active_cliques) : beam_width;
+}
+
+size_t CLEVER::cliqueBytes(const Clique* clique) {
+	return sizeof(Clique) + clique->getAlignmentSet().blockCount() * sizeof(WindowedBitset::block_type);
+}
+
+size_t CLEVER::activeCliqueBytes() const {
+	size_t bytes = 0;
+	for (size_t slot = 0; slot < cliques->slotCount(); ++slot) {
+		if (cliques->at(slot) != nullptr) bytes += cliqueBytes(cliques->at(slot));
+	}
+	return bytes;
+}
+
+void CLEVER::limitActiveCliques(size_t position) {
+	bool exceeded = max_active_cliques != 0 && cliques->size() > max_active_cliques;
+	if (!exceeded && max_active_bytes != 0) exceeded = activeCliqueBytes() > max_active_bytes;
+	if (!bounded) {
+		if (!exceeded) return;
+		bounded = true;
+		bounded_start = position;
+	} else if (!exceeded && cliques->size() <= beam_width) {
+		// the region has been passed, continue in exact mode
+		bounded = false;
+		bounded_regions.push_back(make_pair(bounded_start, position));
+		return;
+	}
+	bounded_end = position;
+	vector<Clique*> active;
+	for (size_t slot = 0; slot < cliques->slotCount(); ++slot) {
+		if (cliques->at(slot) != nullptr) active.push_back(cliques->at(slot));
+	}
+	// best supported cliques first, older ones first among equally supported cliques
+	stable_sort(active.begin(), active.end(), [](const Clique* c1, const Clique* c2) {
+		if (c1->getCliqueReadCount() != c2->getCliqueReadCount()) return c1->getCliqueReadCount() > c2->getCliqueReadCount();
+		return c1->size() > c2->size();
+	});
+	// the beam ends after beam_width cliques or where the memory budget is used up, but keeps at least one clique
+	size_t kept = 0;
+	size_t kept_bytes = 0;
+	while (kept < min((size_t)beam_width, active.size())) {
+		kept_bytes += cliqueBytes(active[kept]);
+		if (max_active_bytes != 0 && kept > 0 && kept_bytes > max_active_bytes) break;
+		++kept;
+	}
+	for (size_t i = kept; i < active.size(); ++i) {
+		cliques->remove(active[i]);
+	}
+	full_cliques.erase(remove_if(full_cliques.begin(), full_cliques.end(), [this](const Clique* c) { return !cliques->contains(c); }), full_cliques.end());
+	for (size_t i = kept; i < active.size(); ++i) {
+		// pruned cliques are reported as they are, so that their reads are not lost; with
+		// max_cliques, finish() only selects among the remaining cliques, the loss is reported there
+		if (max_cliques == 0) {
+			clique_collector.add(unique_ptr<Clique>(active[i]));
+		} else {
+			delete active[i];
+			dropped_cliques += 1;
+		}
+	}
 }
 
 void CLEVER::initialize() {
-    cliques = new clique_list_t();
-    alignments = new AlignmentRecord*[capacity];
-    capacity = alignment_set_t::bits_per_block;
+    cliques = new CliquePool();
+    full_cliques.clear();
+    bounded = false;
+    bounded_regions.clear();
+    dropped_cliques = 0;
+    ring.assign(alignment_set_t::bits_per_block, nullptr);
+    window_start = 0;
   	alignment_count = 0;
     next_id = 0;
-    alignments_by_length.clear();
     clique_counter = 0;
     converged = true;
     initialized = true;
 }
 
 void CLEVER::finish() {
-    // entries of read_in_cliques is set to zero at the beginning of each iteration
-    std::fill(read_in_cliques.begin(), read_in_cliques.end(), 0);
     if(max_cliques == 0){
-        clique_list_t::iterator clique_it = cliques->begin();
-        for (;clique_it!=cliques->end(); ++clique_it) {
-            Clique* clique = *clique_it;
+        for (size_t slot = 0; slot < cliques->slotCount(); ++slot) {
+            Clique* clique = cliques->at(slot);
+            if (clique == nullptr) continue;
+            cliques->remove(clique);
             clique_collector.add(unique_ptr<Clique>(clique));
         }
     } else {
-            while(clique_counter < max_cliques && !cliques->empty()){
-                    // get read with largest priority
-                    unsigned int readref = getPriorityRead();
-                    // get largest Clique to read
-                    Clique* clique = getLargestClique(readref);
-                    if(clique!=nullptr){
-                        if(filter_singletons){
-                            if (clique->getCliqueReadCount() > 1){
-                                // cout up all entries of reads which are contained in clique
-                                for (const auto &r : clique->getCliqueReadNamesSet()){
-                                    read_in_cliques[r] += 1;
-                                }
-                                clique_collector.add(unique_ptr<Clique>(clique));
-                                clique_counter++;
-                                cliques->remove(clique);
-                            // Clique is a singleton and is not added to final clique set
-                            } else {
-                                read_in_cliques[readref] = std::numeric_limits<int>::max();
-                                cliques->remove(clique);
-                                delete clique;
-                            }
-                        // singletons allowed
-                        } else {
-                            // cout up all entries of reads which are contained in clique
-                            for (const auto &r : clique->getCliqueReadNamesSet()){
-                                read_in_cliques[r] += 1;
-                            }
-                            clique_collector.add(unique_ptr<Clique>(clique));
-                            clique_counter++;
-                            cliques->remove(clique);
-                        }
-                    } else {
-                        read_in_cliques[readref] = std::numeric_limits<int>::max();
-                    }
+        // greedily pick the largest clique of the least used read. For every read, the cliques
+        // containing it are listed largest first (in pool order among equally large ones), so
+        // the clique to pick is the first one of the list that has not been taken yet.
+        const unsigned int exhausted = std::numeric_limits<int>::max();
+        vector<Clique*> candidates;
+        vector<vector<size_t> > cliques_by_read(number_of_reads);
+        for (size_t slot = 0; slot < cliques->slotCount(); ++slot) {
+            Clique* clique = cliques->at(slot);
+            if (clique == nullptr) continue;
+            for (const auto &r : clique->getCliqueReadNamesSet()) {
+                cliques_by_read[r].push_back(candidates.size());
+            }
+            candidates.push_back(clique);
+        }
+        for (auto&& list : cliques_by_read) {
+            stable_sort(list.begin(), list.end(), [&candidates](size_t a, size_t b) {
+                return candidates[a]->getCliqueReadCount() > candidates[b]->getCliqueReadCount();
+            });
+        }
+        vector<size_t> next_candidate(number_of_reads, 0);
+        vector<bool> taken(candidates.size(), false);
+        size_t remaining = candidates.size();
+        ReadPriorityQueue usage(number_of_reads);
+        while (clique_counter < max_cliques && remaining > 0 && !usage.empty()) {
+            // get read with largest priority
+            unsigned int readref = usage.top();
+            const vector<size_t>& list = cliques_by_read[readref];
+            size_t& next = next_candidate[readref];
+            while (next < list.size() && taken[list[next]]) ++next;
+            if (next == list.size()) {
+                // no read with a lower count is left that could still select a clique
+                if (usage.count(readref) == exhausted) break;
+                usage.set(readref, exhausted);
+                continue;
+            }
+            // get largest Clique to read
+            Clique* clique = candidates[list[next]];
+            taken[list[next]] = true;
+            remaining -= 1;
+            cliques->remove(clique);
+            if (filter_singletons && clique->getCliqueReadCount() <= 1) {
+                // Clique is a singleton and is not added to final clique set
+                usage.set(readref, exhausted);
+                delete clique;
+            } else {
+                // cout up all entries of reads which are contained in clique
+                for (const auto &r : clique->getCliqueReadNamesSet()) {
+                    usage.increment(r);
+                }
+                clique_collector.add(unique_ptr<Clique>(clique));
+                clique_counter++;
             }
+        }
     }
 
+    if (bounded) {
+        bounded_regions.push_back(make_pair(bounded_start, bounded_end));
+        bounded = false;
+    }
+    if (!bounded_regions.empty()) {
+        ostringstream budget;
+        if (max_active_cliques != 0) budget << max_active_cliques << " cliques";
+        if (max_active_cliques != 0 && max_active_bytes != 0) budget << " or ";
+        if (max_active_bytes != 0) budget << max_active_bytes << " bytes";
+        ostringstream report;
+        for (const auto& region : bounded_regions) {
+            report << "Active cliques exceeded " << budget.str() << " in region " << region.first << "-" << region.second << ", kept at most the " << beam_width << " best supported cliques." << endl;
+        }
+        if (dropped_cliques > 0) {
+            report << "Dropped " << dropped_cliques << " cliques pruned in these regions, since max_cliques only selects among the remaining cliques." << endl;
+        }
+        cerr << report.str();
+        bounded_regions.clear();
+    }
+
+    // cliques not selected above
+    for (size_t slot = 0; slot < cliques->slotCount(); ++slot) {
+        delete cliques->at(slot);
+    }
     delete cliques;
     cliques = nullptr;
+    full_cliques.clear();
 
-    for (size_t i=0; i<alignment_count; ++i) {
-    	delete alignments[i];
-    }
-    delete [] alignments;
-    alignments = nullptr;
+    retire_alignments(alignment_count);
+    ring.clear();
 
     initialized = false;
 }
 
-void CLEVER::reorganize_storage() {
-	alignment_set_t set_union(capacity);
-    
-	clique_list_t::iterator it = cliques->begin();
-	for (;it!=cliques->end(); ++it) {
-		set_union |= (*it)->getAlignmentSet();
-	}
-    
-    size_t new_alignment_count = set_union.count();
-	size_t new_capacity = new_alignment_count * 2;
-	// round up to next multiple of block size
-	int k = new_capacity % alignment_set_t::bits_per_block;
-	if (k > 0) {
-		new_capacity += alignment_set_t::bits_per_block - k;
-	}
-    
-	AlignmentRecord** new_alignments = new AlignmentRecord*[new_capacity];
-	memset(new_alignments,0,new_capacity*sizeof(AlignmentRecord*));
-	// position i in the new tables is equivalent to position "translation_table[i]"
-	// in the old table
-	size_t* translation_table = new size_t[new_alignment_count];
-	size_t j = 0;
-	alignments_by_length.clear();
-	for (size_t i=0; i<alignment_count; ++i) {
-		// test whether alignment i is still in use
-		if (set_union[i]) {
-            translation_table[j] = i;
-			new_alignments[j] = alignments[i];
-			// TODO: Once edge criteria are fixed, we can try to (re-)gain some efficiency here...
- 			// if (single_end) {
-				alignments_by_length.insert(make_pair(0,j));
- 			// } else {
- 			// 	alignments_by_length.insert(make_pair(new_alignments[j]->getInsertLength(),j));
- 			// }
-			j += 1;
-		} else {
-			delete alignments[i];
-		}
-	}
-	// translate bit sets in all active cliques
-	it = cliques->begin();
-	size_t leftmost_pos = (*it)->leftmostSegmentStart();
-	for (;it!=cliques->end(); ++it) {
-		(*it)->translate(translation_table, new_alignment_count, new_capacity);
-		leftmost_pos = min(leftmost_pos, (*it)->leftmostSegmentStart());
+void CLEVER::grow_ring() {
+	vector<AlignmentRecord*> new_ring(ring.size() * 2, nullptr);
+	for (size_t i=window_start; i<alignment_count; ++i) {
+		new_ring[i & (new_ring.size() - 1)] = ring[i & (ring.size() - 1)];
 	}
+	ring.swap(new_ring);
+}
 
-	delete [] translation_table;
-	delete [] alignments;
-	alignments = new_alignments;
-	alignment_count = new_alignment_count;
-	capacity = new_capacity;
+void CLEVER::retire_alignments(size_t oldest_live) {
+	for (; window_start<oldest_live; ++window_start) {
+		AlignmentRecord*& slot = ring[window_start & (ring.size() - 1)];
+		clique_collector.release(slot);
+		slot = nullptr;
+	}
 }
 
 void CLEVER::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, int& edgecounter) {
@@ -194,36 +277,25 @@ void CLEVER::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, i
 	AlignmentRecord* alignment = alignment_autoptr.release();
 	alignment->setID(id);
 
-	// store new alignment
-	if (alignment_count==capacity) {
-		reorganize_storage();
+	// store new alignment; indices grow monotonically and are never translated,
+	// only the slots of retired alignments are reused
+	if (alignment_count - window_start == ring.size()) {
+		grow_ring();
 	}
 	size_t index = alignment_count++;
-	alignments[index] = alignment;
+	ring[index & (ring.size() - 1)] = alignment;
 
-	// TODO: Once edge criteria are fixed, we can try to (re-)gain some efficiency here...
- 	// if (single_end) {
- 	// } else {
- 	// 	alignments_by_length.insert(make_pair(alignment->getInsertLength(), index));
- 	// }
-    
-	// determine all edges from current alignment pair
-	alignment_set_t adjacent(capacity);
-	// determine range of insert lengths to be searched
-	typedef set<length_and_index_t>::const_iterator iterator_t;
-	iterator_t it = alignments_by_length.begin();
-	iterator_t end = alignments_by_length.end();
-    
-	// iterate through all alignments
-	for (; it!=end; ++it) {
-		const AlignmentRecord* alignment2 = alignments[it->second];
+	// determine all edges from current alignment to the resident ones
+	WindowedBitset adjacent(window_start, index);
+	for (size_t i=window_start; i<index; ++i) {
+		const AlignmentRecord* alignment2 = ring[i & (ring.size() - 1)];
         bool set_edge = edge_calculator.edgeBetween(*alignment, *alignment2);
         if (set_edge && (second_edge_calculator != nullptr)) {
 			set_edge = second_edge_calculator->edgeBetween(*alignment, *alignment2);
 		}
 		if (set_edge) {
             edgecounter++;
-			adjacent.set(it->second, true);
+			adjacent.set(i);
 			if (lw != nullptr) {
                 lw->reportEdge(alignment->getID(), alignment2->getID());
 			}
@@ -231,48 +303,91 @@ void CLEVER::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, i
 		}
 	}
 
-    alignments_by_length.insert(make_pair(0, index));
-	// iterate over all active cliques. output those that lie left of current segment and
-	// check intersection with current node for the rest
-	clique_list_t::iterator clique_it = cliques->begin();
+	// output cliques that lie left of the current segment or have reached the size limit,
+	// in the order in which they were added
+	vector<Clique*> finished_cliques;
+	if (max_cliques == 0) {
+		cliques->removeExpired(alignment->getIntervalStart(), finished_cliques);
+	}
+	for (auto&& clique : full_cliques) {
+		if (cliques->contains(clique)) {
+			cliques->remove(clique);
+			finished_cliques.push_back(clique);
+		}
+	}
+	full_cliques.clear();
+	cliques->sortBySlot(finished_cliques);
+	for (auto&& clique : finished_cliques) {
+		// TO DO !!!! should not be added to clique_collector unless criteria is fulfilled given max_cliques (Does it make things worse if cliques are still contained in cliques of clique_finder?
+		clique_collector.add(unique_ptr<Clique>(clique));
+	}
 	// cliques that contain the newly added alignment and
 	// therefore need to be checked for subset relations,
 	// i.e. if one of these cliques is contained in another,
 	// it must be discarded as it is not maximal.
 	vector<Clique*> new_cliques;
-	while (clique_it!=cliques->end()) {
-		Clique* clique = *clique_it;
-        if ((clique->rightmostSegmentEnd() < alignment->getIntervalStart() && max_cliques == 0) || ( limit_clique_size!=0 && clique->size() == limit_clique_size)){
-            // TO DO !!!! should not be added to clique_collector unless criteria is fulfilled given max_cliques (Does it make things worse if cliques are still contained in cliques of clique_finder?
-			clique_it = cliques->erase(clique_it);
-			clique_collector.add(unique_ptr<Clique>(clique));
-		} else {
+	// smallest alignment index referenced by any remaining clique; cliques created
+	// below only contain members of these cliques and the new alignment
+	size_t oldest_live = index;
+	// check intersection with current node for the remaining cliques. Each clique is
+	// classified independently (in parallel for many cliques), then cliques that are
+	// extended or split are collected in slot order.
+	size_t slot_count = cliques->slotCount();
+	split_off_cliques.assign(slot_count, nullptr);
+	extended_cliques.assign(slot_count, 0);
+	auto classify = [&](size_t first_slot, size_t last_slot, size_t& oldest) {
+		for (size_t slot = first_slot; slot < last_slot; ++slot) {
+			const Clique* clique = cliques->at(slot);
+			if (clique == nullptr) continue;
+			oldest = min(oldest, clique->getAlignmentSet().findFirst());
 			// is there an intersection between nodes adjacent to the new
 			// alignment and the currently considered clique?
-			unique_ptr<alignment_set_t> intersection = clique->intersect(adjacent);
-			if (intersection->any()) {
+			size_t common = clique->intersectCount(adjacent);
+			if (common > 0) {
 				// is node adjacent to all nodes in the clique?
-				if (intersection->count() == clique->size()) {
-					clique->add(index);
-					new_cliques.push_back(clique);
-					clique_it = cliques->erase(clique_it);
+				if (common == clique->size()) {
+					extended_cliques[slot] = 1;
 				} else {
-					Clique* split_off_clique = new Clique(*this, intersection);
+					Clique* split_off_clique = new Clique(*this, clique->getAlignmentSet().intersection(adjacent));
 					split_off_clique->add(index);
-					new_cliques.push_back(split_off_clique);
-					++clique_it;
+					split_off_cliques[slot] = split_off_clique;
 				}
-			} else {
-				++clique_it;
 			}
 		}
+	};
+	if (workers != nullptr && slot_count >= PARALLEL_UPDATE_MIN_CLIQUES) {
+		size_t chunks = workers->size() * 4;
+		size_t chunk_size = (slot_count + chunks - 1) / chunks;
+		vector<size_t> chunk_oldest(chunks, index);
+		workers->run(chunks, [&](size_t chunk) {
+			classify(min(slot_count, chunk * chunk_size), min(slot_count, (chunk + 1) * chunk_size), chunk_oldest[chunk]);
+		});
+		oldest_live = *min_element(chunk_oldest.begin(), chunk_oldest.end());
+	} else {
+		classify(0, slot_count, oldest_live);
+	}
+	for (size_t slot = 0; slot < slot_count; ++slot) {
+		if (extended_cliques[slot]) {
+			Clique* clique = cliques->at(slot);
+			cliques->remove(clique);
+			clique->add(index);
+			new_cliques.push_back(clique);
+		} else if (split_off_cliques[slot] != nullptr) {
+			new_cliques.push_back(split_off_cliques[slot]);
+		}
 	}
 	// if current alignment has not been assigned to at least one
 	// of the existing cliques, let it form its own singleton clique
 	if (new_cliques.size() == 0) {
-		new_cliques.push_back(new Clique(*this, index, capacity));
+		new_cliques.push_back(new Clique(*this, index));
+	}
+	// check for subset relations and delete cliques that are subsets of others;
+	// the exact test only runs for pairs whose summaries admit containment
+	vector<SubsetSummary> summaries;
+	summaries.reserve(new_cliques.size());
+	for (auto&& clique : new_cliques) {
+		summaries.push_back(SubsetSummary(*clique));
 	}
-	// check for subset relations and delete cliques that are subsets of others
 	for (size_t i=0; i<new_cliques.size(); ++i) {
 		if (new_cliques[i]==0) continue;
 		Clique* clique_i = new_cliques[i];
@@ -280,13 +395,13 @@ void CLEVER::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, i
 			if (new_cliques[j]==0) continue;
 			Clique* clique_j = new_cliques[j];
 			if (clique_i->size()<=clique_j->size()) {
-				if (clique_j->contains(*clique_i)) {
+				if (summaries[i].mayBeSubsetOf(summaries[j]) && clique_j->contains(*clique_i)) {
 					delete clique_i;
 					new_cliques[i] = nullptr;
 					break;
 				}
 			} else {
-				if (clique_i->contains(*clique_j)) {
+				if (summaries[j].mayBeSubsetOf(summaries[i]) && clique_i->contains(*clique_j)) {
 					delete clique_j;
 					new_cliques[j] = nullptr;
 					continue;
@@ -296,7 +411,14 @@ void CLEVER::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, i
 	}
 	for (size_t i=0; i<new_cliques.size(); ++i) {
 		if (new_cliques[i]!=nullptr) {
-			cliques->push_back(new_cliques[i]);
+			cliques->add(new_cliques[i]);
+			if (limit_clique_size != 0 && new_cliques[i]->size() == limit_clique_size) {
+				full_cliques.push_back(new_cliques[i]);
+			}
 		}
 	}
+	if (max_active_cliques != 0 || max_active_bytes != 0) {
+		limitActiveCliques(alignment->getIntervalStart());
+	}
+	retire_alignments(oldest_live);
 }
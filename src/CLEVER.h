@@ -26,37 +26,75 @@
 
 #include "Clique.h"
 #include "CliqueFinder.h"
+#include "CliquePool.h"
 #include "LogWriter.h"
+#include "WorkerGroup.h"
 
 /** Implementation of the Maximal Clique Enumeration algorithm of CLEVER */
 class CLEVER : public CliqueFinder {
 private:
-    size_t capacity;
-    AlignmentRecord **alignments;
+    /** alignments indexed by absolute position modulo its size, which is a power of two. */
+    std::vector<AlignmentRecord*> ring;
+    /** index of the oldest alignment that is still resident in the ring. */
+    size_t window_start;
+    CliquePool* cliques;
+    /** cliques that reached limit_clique_size while being added and are output with the next alignment. */
+    std::vector<Clique*> full_cliques;
     LogWriter* lw;
     unsigned int max_cliques;
     unsigned int limit_clique_size;
     unsigned int clique_counter;
-    std::vector<unsigned int> read_in_cliques;
+    unsigned int number_of_reads;
     bool filter_singletons;
-    typedef std::pair<unsigned int,size_t> length_and_index_t;
-    std::set<length_and_index_t> alignments_by_length;
-    /** reorganizes the AlignmentRecord data structure to save memory. */
-    void reorganize_storage();
+    /** threads that help with updating many active cliques, nullptr if running on one thread. */
+    WorkerGroup* workers;
+    /** per slot of the clique pool: the clique split off by the current alignment, if any. */
+    std::vector<Clique*> split_off_cliques;
+    /** per slot of the clique pool: whether the current alignment extends the clique (a char per
+     *  slot, so that different threads may set neighbouring entries). */
+    std::vector<char> extended_cliques;
+    /** budgets of active cliques and of their estimated memory in bytes, 0 if unlimited, and number
+     *  of cliques kept when one of them is exceeded. */
+    unsigned int max_active_cliques;
+    size_t max_active_bytes;
+    unsigned int beam_width;
+    /** whether the sweep is in a region where only the beam of best-supported cliques is kept. */
+    bool bounded;
+    size_t bounded_start;
+    size_t bounded_end;
+    std::vector<std::pair<size_t,size_t> > bounded_regions;
+    /** number of pruned cliques that were deleted instead of being reported, because of max_cliques. */
+    size_t dropped_cliques;
+    /** estimated memory of a clique: the object and the blocks of its member bitset. */
+    static size_t cliqueBytes(const Clique* clique);
+    /** enters or leaves bounded mode at the given position and prunes the active cliques to the beam. */
+    void limitActiveCliques(size_t position);
+    /** doubles the ring, keeping every resident alignment at its absolute index. */
+    void grow_ring();
+    /** deletes all alignments with an index below "oldest_live", which are no longer part of any clique. */
+    void retire_alignments(size_t oldest_live);
 public:
     CLEVER(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, LogWriter* lw, unsigned int max_cliques, unsigned int limit_clique_size, unsigned int number_of_reads, bool filter_singletons);
     virtual ~CLEVER();
     const AlignmentRecord & getAlignmentByIndex(size_t index) const {
-        assert(index<alignment_count);
-    	return *(alignments[index]);
+        assert(index>=window_start && index<alignment_count);
+    	return *(ring[index & (ring.size() - 1)]);
     }
-    /** returns index of the element with the highest Priority. */
-    unsigned int getPriorityRead();
-    /** returns the largest clique that contains the read with id equal to "readref". */
-    Clique* getLargestClique(unsigned int readref);
     /** adds qualified cliques to clique_collector and filter the rest. */
     void finish();
     void initialize();
+    /** number of cliques that are currently active. */
+    size_t activeCliqueCount() const { return cliques->size(); }
+    /** lets addAlignment() distribute the update of many active cliques over the given number of threads. */
+    void setThreads(unsigned int threads);
+    /** estimated memory of all active cliques in bytes. */
+    size_t activeCliqueBytes() const;
+    /** whenever more than max_active_cliques cliques are active or they take more than max_active_bytes
+     *  (see activeCliqueBytes()), only the beam_width cliques containing the most reads that fit into
+     *  max_active_bytes are kept until both budgets are met with at most beam_width cliques. The other
+     *  cliques are reported to the clique collector right away, without being extended. A budget of 0
+     *  is unlimited. */
+    void setActiveCliqueLimit(unsigned int max_active_cliques, unsigned int beam_width, size_t max_active_bytes);
     /** constructs the adjacancy bitset for the new alignment and performs clique operations (i.e. create new clique, split a clique) based on the adjacancy bitset of the new Alignment Record. */
     void addAlignment(std::unique_ptr<AlignmentRecord>& ap, int& edgecounter);
 };
@@ -24,27 +24,29 @@
 
 using namespace std;
 
-Clique::Clique(CliqueFinder& parent, size_t index, size_t capacity) : parent(parent) {
-	assert(index < capacity);
-	alignment_set = new alignment_set_t(capacity);
-	alignment_set->set(index, true);
+Clique::Clique(CliqueFinder& parent, size_t index) : alignment_set(index), parent(parent), pool_slot(0), heap_pos(0) {
 	init();
 }
 
-Clique::Clique(CliqueFinder& parent, std::unique_ptr<alignment_set_t>& alignments) : parent(parent) {
-	alignment_set = alignments.release();
+Clique::Clique(CliqueFinder& parent, const WindowedBitset& alignments) : alignment_set(alignments), parent(parent), pool_slot(0), heap_pos(0) {
+	init();
+}
+
+Clique::Clique(CliqueFinder& parent, std::unique_ptr<alignment_set_t>& alignments) : parent(parent), pool_slot(0), heap_pos(0) {
+	for (size_t i=alignments->find_first(); i!=alignment_set_t::npos; i=alignments->find_next(i)) {
+		alignment_set.set(i);
+	}
+	alignments.reset();
 	init();
 }
 
 Clique::~Clique() {
-	delete alignment_set;
 }
 
 void Clique::init() {
 	int n = 0;
 	alignment_count = 0;
-	for (size_t i=0; i<alignment_set->size(); ++i) {
-		if (!alignment_set->test(i)) continue;
+	for (size_t i=alignment_set.findFirst(); i!=WindowedBitset::npos; i=alignment_set.findNext(i)) {
 		const AlignmentRecord& ap = parent.getAlignmentByIndex(i);
 		if (n++==0) {
 			leftmost_segment_start = ap.getIntervalStart();
@@ -61,8 +63,7 @@ void Clique::init() {
 
 void Clique::computeIntervalIntersection(unsigned int* interval_start, unsigned int* interval_end) {
 	int n = 0;
-	for (size_t i=0; i<alignment_set->size(); ++i) {
-		if (!alignment_set->test(i)) continue;
+	for (size_t i=alignment_set.findFirst(); i!=WindowedBitset::npos; i=alignment_set.findNext(i)) {
 		const AlignmentRecord& ap = parent.getAlignmentByIndex(i);
 		if (n++==0) {
 			*interval_start = ap.getIntervalStart();
@@ -74,33 +75,12 @@ void Clique::computeIntervalIntersection(unsigned int* interval_start, unsigned
 	}
 }
 
-void Clique::translate(size_t* translation_table, size_t table_size, size_t new_capacity) {
-	alignment_set_t* new_alignment_set = new alignment_set_t(new_capacity);
-	for (size_t i=0; i<table_size; ++i) {
-		if (alignment_set->test(translation_table[i])) {
-			new_alignment_set->set(i,true);
-		}
-	}
-	delete alignment_set;
-	alignment_set = new_alignment_set;
-}
-
-unique_ptr<alignment_set_t> Clique::intersect(const alignment_set_t& set) const {
-	unique_ptr<alignment_set_t> intersection(new alignment_set_t(set));
-	(*intersection) &= (*alignment_set);
-	return intersection;
-}
-
 bool Clique::contains(const Clique& c) {
-	return c.alignment_set->is_subset_of(*alignment_set);
+	return c.alignment_set.isSubsetOf(alignment_set);
 }
 
 void Clique::add(size_t index) {
-	if (index >= alignment_set->size()) {
-		cout << "Clique::add failure from clique: " << *this <<endl;
-		cout << "Capacity: " << alignment_set->size() << endl;
-	}
-	alignment_set->set(index, true);
+	alignment_set.set(index);
 	const AlignmentRecord& ap = parent.getAlignmentByIndex(index);
 	leftmost_segment_start = min(leftmost_segment_start,(size_t)ap.getIntervalStart());
 	rightmost_segment_end = max(rightmost_segment_end,(size_t)ap.getIntervalEnd());
@@ -111,7 +91,7 @@ void Clique::add(size_t index) {
 
 unique_ptr<vector<const AlignmentRecord*> > Clique::getAllAlignments() const {
 	unique_ptr<vector<const AlignmentRecord*> > result(new vector<const AlignmentRecord*>());
-	for (size_t i=alignment_set->find_first(); i!=alignment_set_t::npos; i=alignment_set->find_next(i)) {
+	for (size_t i=alignment_set.findFirst(); i!=WindowedBitset::npos; i=alignment_set.findNext(i)) {
 		result->push_back(&parent.getAlignmentByIndex(i));
 	}
 	return result;
@@ -120,7 +100,7 @@ unique_ptr<vector<const AlignmentRecord*> > Clique::getAllAlignments() const {
 void Clique::printSet(std::ostream& os) {
 	os << "[";
 	int n = 0;
-	for (size_t i=alignment_set->find_first(); i!=alignment_set_t::npos; i=alignment_set->find_next(i)) {
+	for (size_t i=alignment_set.findFirst(); i!=WindowedBitset::npos; i=alignment_set.findNext(i)) {
 		if (n++>0) os << ",";
 		os << setw(3) << i;
 	}
@@ -129,7 +109,7 @@ void Clique::printSet(std::ostream& os) {
 
 ostream& operator<<(ostream& ostream, const Clique& clique) {
 	vector<alignment_id_t> ids;
-	for (size_t i=clique.alignment_set->find_first(); i!=alignment_set_t::npos; i=clique.alignment_set->find_next(i)) {
+	for (size_t i=clique.alignment_set.findFirst(); i!=WindowedBitset::npos; i=clique.alignment_set.findNext(i)) {
 		ids.push_back(clique.parent.getAlignmentByIndex(i).getID());
 	}
 	ostream << "[" << clique.leftmost_segment_start << ":" << clique.rightmost_segment_end << "]";
@@ -23,6 +23,7 @@
 
 #include "AlignmentRecord.h"
 #include "Types.h"
+#include "WindowedBitset.h"
 
 class CliqueFinder;
 
@@ -31,30 +32,31 @@ private:
 	size_t leftmost_segment_start;
 	size_t rightmost_segment_end;
 	size_t alignment_count;
-	alignment_set_t* alignment_set;
+	WindowedBitset alignment_set;
     std::set<int> cliqueReadNames;
 	CliqueFinder& parent;
+	/** position of the clique in a CliquePool and in the pool's heap. */
+	size_t pool_slot;
+	size_t heap_pos;
 	/** computes insert_start, insert_end, and rightmost_segment_end from all contained alignments. */
 	void init();
 	/** debugs function. */
 	void printSet(std::ostream& os);
 
 public:
-	Clique(CliqueFinder& parent, size_t index, size_t capacity);
+	Clique(CliqueFinder& parent, size_t index);
+	Clique(CliqueFinder& parent, const WindowedBitset& alignments);
 	Clique(CliqueFinder& parent, std::unique_ptr<alignment_set_t>& alignments);
 	virtual ~Clique();
     /** adds the Alignment Record with the given index to the clique. */
 	void add(size_t index);
-	/** returns the intersection between nodes in the clique and the given set of nodes. */
-	std::unique_ptr<alignment_set_t> intersect(const alignment_set_t& set) const;
-	/** updates the current bit set representation by a new one, where
-	    new_table[j] := old_table[translation_table[j]]. */
-	void translate(size_t* translation_table, size_t table_size, size_t new_capacity);
+	/** returns the number of nodes in the clique that are also in the given set of nodes. */
+	size_t intersectCount(const WindowedBitset& set) const { return alignment_set.intersectCount(set); }
 	size_t leftmostSegmentStart() const { return leftmost_segment_start; }
 	size_t rightmostSegmentEnd() const { return rightmost_segment_end; }
 	bool contains(const Clique& c);
 	size_t size() const { return alignment_count; }
-	const alignment_set_t& getAlignmentSet() const { return *alignment_set; }
+	const WindowedBitset& getAlignmentSet() const { return alignment_set; }
 	std::unique_ptr<std::vector<const AlignmentRecord*> > getAllAlignments() const;
     /** computes the start and end position of the Alignment Records in the clique. */
 	void computeIntervalIntersection(unsigned int* insert_start, unsigned int* insert_end);
@@ -62,6 +64,8 @@ public:
     const std::set<int>& getCliqueReadNamesSet() const{return cliqueReadNames; }
     unsigned int getCliqueReadCount() const { return cliqueReadNames.size(); }
 
+    friend class CliquePool;
+
 };
 
 #endif /* CLIQUE_H_ */
@@ -20,31 +20,163 @@
 #define CLIQUECOLLECTOR_H_
 
 #include <deque>
+#include <vector>
 #include <algorithm>
+#include <unordered_set>
 
 #include "Clique.h"
 #include "LogWriter.h"
+#include "ThreadPool.h"
 
 class CliqueCollector {
 private:
+    /** merges the members of one clique into the super read at a reserved position. */
+    class MergeJob {
+    private:
+        std::unique_ptr<std::vector<const AlignmentRecord*>> alignments;
+        unsigned int id;
+        AlignmentRecord** result;
+    public:
+        MergeJob(std::unique_ptr<std::vector<const AlignmentRecord*>>& alignments, unsigned int id, AlignmentRecord** result) : alignments(std::move(alignments)), id(id), result(result) {}
+        void run() { *result = new AlignmentRecord(alignments, id); }
+    };
+    class MergeWriter {
+    public:
+        void write(std::unique_ptr<MergeJob>) {}
+    };
+    /** number of released alignments after which pending merges are waited for, so that
+     *  they can be deleted. */
+    static const size_t RELEASE_BATCH = 65536;
+
     std::deque<AlignmentRecord*>* super_reads;
     LogWriter* lw;
     unsigned int id;
+    int threads;
+    MergeWriter merge_writer;
+    /** created on demand; merges run in the background until drain(). */
+    ThreadPool<MergeJob, MergeWriter>* merge_pool;
+    /** alignments released while merges were pending. */
+    std::vector<AlignmentRecord*> released;
+    /** alignments that became super reads of singleton cliques. Clique finders still release
+     *  them, which only clears the mark. */
+    std::unordered_set<const AlignmentRecord*> adopted;
+    bool memoize;
+    bool track_settled;
+    /** super reads of singleton cliques of the current iteration. Their alignments had no edges. */
+    std::unordered_set<const AlignmentRecord*> settling;
+    /** settled super reads among those returned by the last call of finish(). */
+    std::unordered_set<const AlignmentRecord*> settled;
+    /** read sets of the super reads added in this iteration. */
+    std::unordered_set<read_set_fingerprint_t, read_set_fingerprint_hash> fingerprints;
+
+    /** returns false if a super read for the same original reads was added before in this
+     *  iteration. Otherwise, read_count is set to the number of original reads of the clique. */
+    bool memoizeClique(const std::vector<const AlignmentRecord*>& alignments, size_t& read_count) {
+        std::vector<int> reads;
+        for (const auto& a : alignments) {
+            reads.insert(reads.end(), a->getReadNamesSet().begin(), a->getReadNamesSet().end());
+        }
+        std::sort(reads.begin(), reads.end());
+        reads.erase(std::unique(reads.begin(), reads.end()), reads.end());
+        read_set_fingerprint_t fingerprint;
+        for (int read : reads) {
+            fingerprint.add(read);
+        }
+        read_count = reads.size();
+        return fingerprints.insert(fingerprint).second;
+    };
+    /** takes over the member that already holds all read_count original reads of the clique, i.e.
+     *  the super read built for the same read set in the previous iteration, instead of merging the
+     *  clique again. Returns nullptr if there is no such member or it has been taken over before. */
+    AlignmentRecord* recall(const std::vector<const AlignmentRecord*>& alignments, size_t read_count) {
+        for (const auto& a : alignments) {
+            if (a->getReadCount() == read_count) return adopt(a);
+        }
+        return nullptr;
+    };
+
+    /** waits for all pending merges and deletes the released alignments. */
+    void drain() {
+        delete merge_pool;
+        merge_pool = nullptr;
+        for (auto&& alignment : released) {
+            delete alignment;
+        }
+        released.clear();
+    };
 public:
-    CliqueCollector(LogWriter* lw) : lw(lw), id(0) {
+    CliqueCollector(LogWriter* lw) : lw(lw), id(0), threads(1), merge_pool(nullptr), memoize(false), track_settled(false) {
         super_reads = new std::deque<AlignmentRecord*>;
     };
 
     virtual ~CliqueCollector() {
+        drain();
         assert(super_reads->empty());
         delete super_reads;
     };
+    /** merges super reads of cliques with several members on the given number of threads
+     *  while the clique finder goes on. Not used together with a LogWriter. */
+    void setThreads(int threads) {
+        drain();
+        this->threads = threads;
+    };
+    /** takes over an alignment that forms a clique on its own as super read instead of copying
+     *  it. Returns nullptr if the alignment has been taken over before; then it has to be copied. */
+    AlignmentRecord* adopt(const AlignmentRecord* alignment) {
+        if (!adopted.insert(alignment).second) return nullptr;
+        return const_cast<AlignmentRecord*>(alignment);
+    };
+    /** drops cliques of the same original reads as a clique added before in the same iteration,
+     *  and reuses a member that already holds all original reads of its clique as the clique's
+     *  super read instead of merging the clique again. This is an approximation: the other
+     *  members, whose reads the reused super read already contains, are not folded in again. */
+    void setMemoization(bool memoize) {
+        this->memoize = memoize;
+    };
+    /** remembers which super reads stem from singleton cliques, see isSettled(). Only valid for
+     *  clique finders that report every alignment with an edge in a larger clique. */
+    void setSettledTracking(bool track_settled) {
+        this->track_settled = track_settled;
+    };
+    /** returns true if the super read returned by the last call of finish() stems from a
+     *  singleton clique, i.e. it had no edge to any other alignment of its iteration. */
+    bool isSettled(const AlignmentRecord* super_read) const {
+        return settled.count(super_read) > 0;
+    };
+    /** passes a settled super read on as its own super read without a clique finder. */
+    void carry(std::unique_ptr<AlignmentRecord>& super_read) {
+        assert(super_read.get() != nullptr);
+        if (memoize && !fingerprints.insert(super_read->getFingerprint()).second) return;
+        this->id++;
+        if (track_settled) settling.insert(super_read.get());
+        super_reads->push_back(super_read.release());
+    };
+    /** deletes an alignment a clique finder is done with, or defers this until merges that
+     *  may still read it have finished. Clique finders must use this instead of delete for
+     *  alignments that were part of added cliques, since alignments of singleton cliques are
+     *  taken over as super reads. */
+    void release(AlignmentRecord* alignment) {
+        if (adopted.erase(alignment) > 0) return;
+        if (merge_pool == nullptr) {
+            delete alignment;
+            return;
+        }
+        released.push_back(alignment);
+        if (released.size() >= RELEASE_BATCH) drain();
+    };
     /** adds deactivated and qualified cliques to cliqueCollector. */
-	void add(std::unique_ptr<Clique> clique) {
+	virtual void add(std::unique_ptr<Clique> clique) {
         assert(clique.get() != nullptr);
 
         std::unique_ptr<std::vector<const AlignmentRecord*>> alignments = clique->getAllAlignments();
 
+        size_t read_count = 0;
+        if (memoize && !memoizeClique(*alignments, read_count)) return;
+        AlignmentRecord* memoized = nullptr;
+        if (memoize && alignments->size() > 1) {
+            memoized = recall(*alignments, read_count);
+        }
+
         if (lw != nullptr) {
             std::list<unsigned int> cll;            
             for (const auto& a : *alignments) {
@@ -53,13 +185,28 @@ public:
             lw->reportClique(this->id, cll);
         }
 
+        if (alignments->size() > 1 && memoized == nullptr && threads > 1 && lw == nullptr) {
+            // reserve the position now, so that the order does not depend on the threads
+            super_reads->push_back(nullptr);
+            if (merge_pool == nullptr) {
+                merge_pool = new ThreadPool<MergeJob, MergeWriter>(threads, 8, threads * 4, merge_writer);
+            }
+            merge_pool->addTask(std::unique_ptr<MergeJob>(new MergeJob(alignments, this->id++, &super_reads->back())));
+            return;
+        }
+
         AlignmentRecord* ar;
-        if (alignments->size() > 1) {
+        if (memoized != nullptr) {
+            ar = memoized;
+            ar->setName("Clique_" + std::to_string(this->id++));
+        } else if (alignments->size() > 1) {
             // id gets increased in all iterations, never set to 0 anymore
             ar = new AlignmentRecord(alignments, this->id++);
         } else {
-            ar = new AlignmentRecord(*(alignments->front()));
+            ar = adopt(alignments->front());
+            if (ar == nullptr) ar = new AlignmentRecord(*(alignments->front()));
             this->id++;
+            if (track_settled) settling.insert(ar);
         }
 
         if (lw != nullptr) {
@@ -69,9 +216,23 @@ public:
 
         super_reads->push_back(ar);
     };
+    /** adds a super read that has been built elsewhere and gives it the next clique id;
+     *  super reads merged from several alignments are renamed accordingly. */
+    void addSuperRead(std::unique_ptr<AlignmentRecord> super_read, bool merged) {
+        assert(super_read.get() != nullptr);
+        if (memoize && !fingerprints.insert(super_read->getFingerprint()).second) return;
+        if (merged) {
+            super_read->setName("Clique_" + std::to_string(this->id));
+        } else if (track_settled) {
+            settling.insert(super_read.get());
+        }
+        this->id++;
+        super_reads->push_back(super_read.release());
+    };
     /** sorts the Alignment Records based on their starting position and returns them. */
     std::deque<AlignmentRecord*>* finish()
     {
+        drain();
         auto retVal = super_reads;
 
         auto comp = [](AlignmentRecord* r1, AlignmentRecord* r2) { return r1->getIntervalStart() < r2->getIntervalStart(); };
@@ -79,6 +240,9 @@ public:
         sort(retVal->begin(), retVal->end(), comp);
 
         super_reads = new std::deque<AlignmentRecord*>;
+        fingerprints.clear();
+        settled.swap(settling);
+        settling.clear();
         return retVal;
     };
 };
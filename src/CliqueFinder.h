@@ -16,7 +16,6 @@ protected:
     bool converged;
 
     typedef std::list<Clique*> clique_list_t;
-    clique_list_t *cliques;    
 
     size_t alignment_count;
     const EdgeCalculator *second_edge_calculator;
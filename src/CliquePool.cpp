@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cassert>
+
+#include "CliquePool.h"
+
+using namespace std;
+
+CliquePool::CliquePool() : live(0) {
+}
+
+CliquePool::~CliquePool() {
+}
+
+void CliquePool::compact() {
+	size_t j = 0;
+	for (size_t i=0; i<slots.size(); ++i) {
+		if (slots[i] == nullptr) continue;
+		slots[j] = slots[i];
+		slots[j]->pool_slot = j;
+		j += 1;
+	}
+	slots.resize(j);
+}
+
+void CliquePool::swapHeap(size_t i, size_t j) {
+	swap(heap[i], heap[j]);
+	heap[i]->heap_pos = i;
+	heap[j]->heap_pos = j;
+}
+
+void CliquePool::siftUp(size_t pos) {
+	while (pos > 0) {
+		size_t parent = (pos - 1) / 2;
+		if (heap[parent]->rightmostSegmentEnd() <= heap[pos]->rightmostSegmentEnd()) break;
+		swapHeap(parent, pos);
+		pos = parent;
+	}
+}
+
+void CliquePool::siftDown(size_t pos) {
+	while (true) {
+		size_t smallest = pos;
+		size_t left = 2 * pos + 1;
+		size_t right = left + 1;
+		if (left < heap.size() && heap[left]->rightmostSegmentEnd() < heap[smallest]->rightmostSegmentEnd()) smallest = left;
+		if (right < heap.size() && heap[right]->rightmostSegmentEnd() < heap[smallest]->rightmostSegmentEnd()) smallest = right;
+		if (smallest == pos) break;
+		swapHeap(pos, smallest);
+		pos = smallest;
+	}
+}
+
+void CliquePool::removeFromHeap(size_t pos) {
+	size_t last = heap.size() - 1;
+	if (pos != last) {
+		swapHeap(pos, last);
+	}
+	heap.pop_back();
+	if (pos < heap.size()) {
+		siftDown(pos);
+		siftUp(pos);
+	}
+}
+
+void CliquePool::add(Clique* clique) {
+	if (slots.size() > 64 && slots.size() > 2 * live) {
+		compact();
+	}
+	clique->pool_slot = slots.size();
+	slots.push_back(clique);
+	clique->heap_pos = heap.size();
+	heap.push_back(clique);
+	siftUp(clique->heap_pos);
+	live += 1;
+}
+
+void CliquePool::remove(Clique* clique) {
+	assert(contains(clique));
+	slots[clique->pool_slot] = nullptr;
+	removeFromHeap(clique->heap_pos);
+	live -= 1;
+}
+
+void CliquePool::removeExpired(size_t position, std::vector<Clique*>& expired) {
+	while (!heap.empty() && heap[0]->rightmostSegmentEnd() < position) {
+		Clique* clique = heap[0];
+		slots[clique->pool_slot] = nullptr;
+		removeFromHeap(0);
+		live -= 1;
+		expired.push_back(clique);
+	}
+}
+
+bool CliquePool::contains(const Clique* clique) const {
+	return clique->pool_slot < slots.size() && slots[clique->pool_slot] == clique;
+}
+
+void CliquePool::sortBySlot(std::vector<Clique*>& cliques) const {
+	sort(cliques.begin(), cliques.end(), [](const Clique* c1, const Clique* c2) { return c1->pool_slot < c2->pool_slot; });
+}
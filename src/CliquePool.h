@@ -0,0 +1,44 @@
+#ifndef CLIQUEPOOL_H_
+#define CLIQUEPOOL_H_
+
+#include <vector>
+
+#include "Clique.h"
+
+/** Active cliques of CLEVER, kept in insertion order. Each clique remembers its slot in
+ *  the pool and its position in a min-heap on the rightmost segment end, so that removal
+ *  needs no search and cliques left of the sweep are found without visiting the others.
+ *  Removed slots stay empty until add() squeezes them out. */
+class CliquePool {
+private:
+	std::vector<Clique*> slots;
+	std::vector<Clique*> heap;
+	size_t live;
+
+	void compact();
+	void swapHeap(size_t i, size_t j);
+	void siftUp(size_t pos);
+	void siftDown(size_t pos);
+	void removeFromHeap(size_t pos);
+public:
+	CliquePool();
+	virtual ~CliquePool();
+
+	/** appends clique to the pool. */
+	void add(Clique* clique);
+	/** removes clique from the pool without deleting it. */
+	void remove(Clique* clique);
+	/** removes all cliques whose rightmost segment ends before position and appends them to expired. */
+	void removeExpired(size_t position, std::vector<Clique*>& expired);
+	bool contains(const Clique* clique) const;
+	/** sorts cliques that have been removed since the last add() by the slots they occupied. */
+	void sortBySlot(std::vector<Clique*>& cliques) const;
+	size_t size() const { return live; }
+	bool empty() const { return live == 0; }
+	/** number of slots including empty ones, see at(). */
+	size_t slotCount() const { return slots.size(); }
+	/** returns the clique in the given slot or nullptr for an empty slot. */
+	Clique* at(size_t slot) const { return slots[slot]; }
+};
+
+#endif /* CLIQUEPOOL_H_ */
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <vector>
+
+#include "GraphProfile.h"
+#include "CLEVER.h"
+
+using namespace std;
+
+const size_t GraphProfile::PROBE_WINDOWS = 8;
+const size_t GraphProfile::PROBE_WINDOW_READS = 50;
+const double GraphProfile::BRONKERBOSCH_MAX_BITSET_BYTES = 1024.0 * 1024.0 * 1024.0;
+
+namespace {
+
+/** lets the probe run CLEVER without building super reads. */
+class DiscardingCollector : public CliqueCollector {
+public:
+	DiscardingCollector() : CliqueCollector(nullptr) {}
+	void add(std::unique_ptr<Clique>) {}
+};
+
+/** answers edge queries of the probe's CLEVER run from the edges already computed for the
+ *  window; CLEVER numbers the reads of a window in order from 0. */
+class WindowEdges : public EdgeCalculator {
+public:
+	size_t n;
+	std::vector<char> adjacent;
+	explicit WindowEdges(size_t n) : n(n), adjacent(n * n, 0) {}
+	bool edgeBetween(const AlignmentRecord& ar1, const AlignmentRecord& ar2) const {
+		return adjacent[ar1.getID() * n + ar2.getID()] != 0;
+	}
+	void getPartnerLengthRange(const AlignmentRecord&, unsigned int*, unsigned int*) const {}
+};
+
+size_t findRoot(vector<size_t>& parent, size_t v) {
+	while (parent[v] != v) {
+		parent[v] = parent[parent[v]];
+		v = parent[v];
+	}
+	return v;
+}
+
+}
+
+GraphProfile::GraphProfile(const deque<AlignmentRecord*>& reads, const std::function<bool(const AlignmentRecord&)>& skip, const EdgeCalculator& edge_calculator, const EdgeCalculator* second_edge_calculator) : reads(0), probe_reads(0), probe_edges(0), max_degree(0), mean_active_cliques(0.0), max_active_cliques(0), mean_component(0.0), max_component(0) {
+	// reads are sorted by start; a read starting right of all previous ends opens a new stretch
+	// of overlapping reads, which no component crosses
+	vector<const AlignmentRecord*> kept;
+	vector<size_t> stretch;
+	vector<size_t> stretch_size;
+	unsigned int stretch_end = 0;
+	for (const auto& read : reads) {
+		if (skip(*read)) continue;
+		if (kept.empty() || read->getIntervalStart() > stretch_end) {
+			stretch_size.push_back(0);
+			stretch_end = read->getIntervalEnd();
+		}
+		stretch_end = max(stretch_end, read->getIntervalEnd());
+		stretch.push_back(stretch_size.size() - 1);
+		stretch_size.back() += 1;
+		kept.push_back(read);
+	}
+	this->reads = kept.size();
+
+	// windows of consecutive reads, spread evenly over the region
+	vector<size_t> window_starts;
+	size_t window_reads = min(PROBE_WINDOW_READS, kept.size());
+	if (kept.size() <= PROBE_WINDOWS * PROBE_WINDOW_READS) {
+		for (size_t s = 0; s < kept.size(); s += PROBE_WINDOW_READS) window_starts.push_back(s);
+	} else {
+		for (size_t k = 0; k < PROBE_WINDOWS; ++k) {
+			window_starts.push_back(k * (kept.size() - window_reads) / (PROBE_WINDOWS - 1));
+		}
+	}
+
+	double active_sum = 0.0;
+	double component_sum = 0.0;
+	for (size_t start : window_starts) {
+		size_t end = min(start + window_reads, kept.size());
+		size_t n = end - start;
+		probe_reads += n;
+
+		// degrees and connected components within the window
+		WindowEdges edges(n);
+		vector<size_t> degree(n, 0);
+		vector<size_t> parent(n);
+		for (size_t i = 0; i < n; ++i) parent[i] = i;
+		for (size_t i = 0; i < n; ++i) {
+			const AlignmentRecord& read = *kept[start + i];
+			for (size_t j = 0; j < i; ++j) {
+				if (kept[start + j]->getIntervalEnd() < read.getIntervalStart()) continue;
+				bool edge = edge_calculator.edgeBetween(read, *kept[start + j]);
+				if (edge && second_edge_calculator != nullptr) {
+					edge = second_edge_calculator->edgeBetween(read, *kept[start + j]);
+				}
+				if (edge) {
+					edges.adjacent[i * n + j] = edges.adjacent[j * n + i] = 1;
+					degree[i] += 1;
+					degree[j] += 1;
+					probe_edges += 1;
+					parent[findRoot(parent, i)] = findRoot(parent, j);
+				}
+			}
+		}
+		max_degree = max(max_degree, *max_element(degree.begin(), degree.end()));
+		if (findRoot(parent, 0) == findRoot(parent, n - 1)) {
+			size_t size = stretch_size[stretch[start]];
+			component_sum += double(size) * n;
+			max_component = max(max_component, size);
+		} else {
+			vector<size_t> sizes(n, 0);
+			for (size_t i = 0; i < n; ++i) sizes[findRoot(parent, i)] += 1;
+			for (size_t i = 0; i < n; ++i) {
+				component_sum += sizes[findRoot(parent, i)];
+				max_component = max(max_component, sizes[i]);
+			}
+		}
+
+		// growth of the active cliques of CLEVER on copies of the window
+		DiscardingCollector collector;
+		CLEVER clever(edges, collector, nullptr, 0, 0, 0, false);
+		clever.initialize();
+		int edgecounter = 0;
+		for (size_t i = start; i < end; ++i) {
+			unique_ptr<AlignmentRecord> copy(new AlignmentRecord(*kept[i]));
+			clever.addAlignment(copy, edgecounter);
+			active_sum += clever.activeCliqueCount();
+			max_active_cliques = max(max_active_cliques, clever.activeCliqueCount());
+		}
+		clever.finish();
+	}
+	if (probe_reads > 0) {
+		mean_active_cliques = active_sum / probe_reads;
+		mean_component = component_sum / probe_reads;
+	}
+}
+
+double GraphProfile::meanDegree() const {
+	return (probe_reads > 0) ? 2.0 * probe_edges / probe_reads : 0.0;
+}
+
+double GraphProfile::componentSize() const {
+	return mean_component;
+}
+
+double GraphProfile::cleverCost() const {
+	return reads * mean_active_cliques;
+}
+
+double GraphProfile::bronKerboschCost() const {
+	// every read takes part in about degree recursion steps over bit sets of its component
+	return reads * max(1.0, meanDegree()) * (componentSize() / 64.0 + 1.0);
+}
+
+bool GraphProfile::prefersBronKerbosch() const {
+	return reads * componentSize() / 8.0 <= BRONKERBOSCH_MAX_BITSET_BYTES && bronKerboschCost() < cleverCost();
+}
+
+ostream& operator<<(ostream& os, const GraphProfile& profile) {
+	os << "reads " << profile.reads << ", probe " << profile.probe_reads << " reads with " << profile.probe_edges << " edges";
+	os << ", degree mean " << profile.meanDegree() << " max " << profile.max_degree;
+	os << ", active cliques mean " << profile.mean_active_cliques << " max " << profile.max_active_cliques;
+	os << ", component mean " << profile.componentSize() << " max " << profile.max_component;
+	os << ", estimated cost clever " << profile.cleverCost() << " bronkerbosch " << profile.bronKerboschCost();
+	return os;
+}
@@ -0,0 +1,51 @@
+#ifndef GRAPHPROFILE_H_
+#define GRAPHPROFILE_H_
+
+#include <deque>
+#include <functional>
+#include <ostream>
+
+#include "AlignmentRecord.h"
+#include "EdgeCalculator.h"
+
+/** Statistics of the read graph of one iteration that are used to choose the clique finder.
+ *  They are taken from PROBE_WINDOWS windows of consecutive reads spread evenly over the
+ *  region. CLEVER compares every read against all active cliques, so its cost is estimated
+ *  from the growth of active cliques. BronKerbosch recurses over the neighbourhoods with
+ *  one adjacency bit set per read of its connected component, so its cost is estimated
+ *  from the degrees and the component sizes. */
+class GraphProfile {
+private:
+	static const size_t PROBE_WINDOWS;
+	static const size_t PROBE_WINDOW_READS;
+	/** BronKerbosch keeps the adjacency bit sets of all components until finish(), about
+	 *  reads * componentSize() bits; above this many bytes it is not considered. */
+	static const double BRONKERBOSCH_MAX_BITSET_BYTES;
+
+	size_t reads;
+	size_t probe_reads;
+	size_t probe_edges;
+	size_t max_degree;
+	double mean_active_cliques;
+	size_t max_active_cliques;
+	/** component size seen by an average read and the largest estimated component. */
+	double mean_component;
+	size_t max_component;
+public:
+	/** profiles the given reads, ignoring those for which skip returns true. */
+	GraphProfile(const std::deque<AlignmentRecord*>& reads, const std::function<bool(const AlignmentRecord&)>& skip, const EdgeCalculator& edge_calculator, const EdgeCalculator* second_edge_calculator);
+
+	double meanDegree() const;
+	/** estimated size of the connected component of an average read. A window whose first
+	 *  and last read are connected is taken to lie in a component that fills its stretch of
+	 *  overlapping reads; otherwise the components inside the window are used. */
+	double componentSize() const;
+	/** estimated operations of CLEVER and BronKerbosch for the whole iteration. */
+	double cleverCost() const;
+	double bronKerboschCost() const;
+	bool prefersBronKerbosch() const;
+
+	friend std::ostream& operator<<(std::ostream& os, const GraphProfile& profile);
+};
+
+#endif /* GRAPHPROFILE_H_ */
@@ -0,0 +1,161 @@
+#include <algorithm>
+
+#include "GreedyCliqueCover.h"
+#include "WindowedBitset.h"
+
+using namespace std;
+
+GreedyCliqueCover::GreedyCliqueCover(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, LogWriter* lw) : CliqueFinder(edge_calculator, clique_collector), lw(lw) {
+}
+
+GreedyCliqueCover::~GreedyCliqueCover() {
+    for (auto&& alignment : alignments) {
+        if (alignment != nullptr) clique_collector.release(alignment);
+    }
+}
+
+void GreedyCliqueCover::initialize() {
+    assert(not initialized);
+    for (auto&& alignment : alignments) {
+        if (alignment != nullptr) clique_collector.release(alignment);
+    }
+    alignments.clear();
+    neighbours.clear();
+    actives.clear();
+    pending.clear();
+    open.clear();
+    covered.clear();
+    hits.clear();
+    candidate.clear();
+    alignment_count = 0;
+    next_id = 0;
+    initialized = true;
+    converged = true;
+}
+
+void GreedyCliqueCover::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, int& edgecounter) {
+    assert(alignment_autoptr.get() != nullptr);
+    assert(initialized);
+
+    alignment_id_t id = next_id++;
+    AlignmentRecord* alignment = alignment_autoptr.release();
+    alignment->setID(id);
+
+    size_t index = alignment_count++;
+    alignments.push_back(alignment);
+    neighbours.push_back(vector<size_t>());
+    pending.push_back(1);
+    open.push_back(1);
+    covered.push_back(0);
+    hits.push_back(0);
+    candidate.push_back(0);
+    vector<size_t> ready;
+
+    size_t kept = 0;
+    for (size_t a = 0; a < actives.size(); ++a) {
+        size_t index2 = actives[a];
+        const AlignmentRecord* alignment2 = alignments[index2];
+        // reads arrive sorted by start, so a read ending left of this one is done
+        if (alignment->getIntervalStart() > alignment2->getIntervalEnd()) {
+            retire(index2, ready);
+            continue;
+        }
+        actives[kept++] = index2;
+        bool set_edge = edge_calculator.edgeBetween(*alignment, *alignment2);
+        if (set_edge && (second_edge_calculator != nullptr)) {
+            set_edge = second_edge_calculator->edgeBetween(*alignment, *alignment2);
+        }
+        if (set_edge) {
+            edgecounter++;
+            neighbours[index].push_back(index2);
+            neighbours[index2].push_back(index);
+            // both reads are active
+            pending[index] += 1;
+            pending[index2] += 1;
+            open[index] += 1;
+            open[index2] += 1;
+            if (lw != nullptr) lw->reportEdge(alignment->getID(), alignment2->getID());
+            converged = false;
+        }
+    }
+    actives.resize(kept);
+    actives.push_back(index);
+    cover(ready);
+}
+
+void GreedyCliqueCover::retire(size_t v, vector<size_t>& ready) {
+    if (--pending[v] == 0) ready.push_back(v);
+    for (size_t w : neighbours[v]) {
+        if (--pending[w] == 0) ready.push_back(w);
+    }
+}
+
+void GreedyCliqueCover::release(size_t v) {
+    clique_collector.release(alignments[v]);
+    alignments[v] = nullptr;
+    vector<size_t>().swap(neighbours[v]);
+}
+
+void GreedyCliqueCover::cover(vector<size_t>& ready) {
+    auto by_degree = [this](size_t a, size_t b) {
+        if (neighbours[a].size() != neighbours[b].size()) return neighbours[a].size() > neighbours[b].size();
+        return a < b;
+    };
+    sort(ready.begin(), ready.end(), by_degree);
+
+    vector<size_t> members;
+    vector<size_t> finished;
+    for (size_t seed : ready) {
+        if (!covered[seed]) {
+            // the seed and its neighbours have retired, so the adjacency of all candidates is final
+            vector<size_t> candidates(neighbours[seed]);
+            sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+                if (covered[a] != covered[b]) return covered[a] < covered[b];
+                return by_degree(a, b);
+            });
+            for (size_t u : candidates) {
+                candidate[u] = 1;
+                hits[u] = 1;
+            }
+            members.assign(1, seed);
+            for (size_t u : candidates) {
+                // u is adjacent to all members iff every member has counted it
+                if (hits[u] != members.size()) continue;
+                members.push_back(u);
+                for (size_t w : neighbours[u]) {
+                    if (candidate[w]) hits[w] += 1;
+                }
+            }
+            for (size_t u : candidates) {
+                candidate[u] = 0;
+                hits[u] = 0;
+            }
+
+            WindowedBitset set;
+            for (size_t m : members) {
+                set.set(m);
+                covered[m] = 1;
+            }
+            clique_collector.add(unique_ptr<Clique>(new Clique(*this, set)));
+        }
+        // the seed's turn is over; reads whose neighbourhood has had all turns cannot join a clique any more
+        for (size_t w : neighbours[seed]) {
+            if (--open[w] == 0) finished.push_back(w);
+        }
+        if (--open[seed] == 0) finished.push_back(seed);
+    }
+    for (size_t v : finished) {
+        release(v);
+    }
+}
+
+void GreedyCliqueCover::finish() {
+    assert(initialized);
+    vector<size_t> ready;
+    for (size_t v : actives) {
+        retire(v, ready);
+    }
+    actives.clear();
+    cover(ready);
+    initialized = false;
+}
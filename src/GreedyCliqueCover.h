@@ -0,0 +1,54 @@
+#ifndef GREEDYCLIQUECOVER_H_
+#define GREEDYCLIQUECOVER_H_
+
+#include <vector>
+
+#include "CliqueFinder.h"
+#include "LogWriter.h"
+
+/** Covers the read graph by cliques instead of enumerating all maximal cliques. The
+ *  cover is built along the interval sweep: once a read and all of its neighbours have
+ *  retired from the sweep, its adjacency is final and it can seed a clique if it is not
+ *  covered yet. Among the reads that become ready together, seeds are taken in order of
+ *  decreasing degree, and each seed's clique is grown from its neighbours, uncovered and
+ *  high-degree neighbours first. Every read ends up in at least one clique, and the work
+ *  per clique is linear in the degrees of its members. Reads that cannot join any further
+ *  clique are released together with their adjacency. */
+class GreedyCliqueCover : public CliqueFinder {
+private:
+    std::vector<AlignmentRecord*> alignments;
+    std::vector<std::vector<size_t> > neighbours;
+    /** reads whose interval may still overlap the next read. */
+    std::vector<size_t> actives;
+    /** per read: number of active reads among the read and its neighbours; the read is ready to seed at 0. */
+    std::vector<size_t> pending;
+    /** per read: number of reads among the read and its neighbours that have not had their seed turn yet;
+     *  at 0, the read cannot join any further clique. */
+    std::vector<size_t> open;
+    std::vector<char> covered;
+    /** scratch space of cover(), hits[u] counts the members of the current clique adjacent to u. */
+    std::vector<size_t> hits;
+    std::vector<char> candidate;
+    LogWriter* lw;
+
+    /** takes v out of the sweep and appends the reads that became ready to ready. */
+    void retire(size_t v, std::vector<size_t>& ready);
+    /** lets the ready reads seed cliques and releases the reads that cannot join any further clique. */
+    void cover(std::vector<size_t>& ready);
+    void release(size_t v);
+public:
+    GreedyCliqueCover(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, LogWriter* lw);
+    virtual ~GreedyCliqueCover();
+
+    virtual const AlignmentRecord & getAlignmentByIndex(size_t index) const {
+        assert(index<alignment_count);
+        return *(alignments[index]);
+    }
+
+    void addAlignment(std::unique_ptr<AlignmentRecord>& ap, int& edgecounter);
+    void initialize();
+    /** covers the reads that are still waiting and adds their cliques to clique_collector. */
+    void finish();
+};
+
+#endif /* GREEDYCLIQUECOVER_H_ */
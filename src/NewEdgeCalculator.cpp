@@ -74,7 +74,7 @@ int computeRevSOffset(const std::vector<char>& cigar);
      std::array<std::array<double,127>,127> probM_unEqBase_values = compute_probM_unEqBase_values();
  }
 
-NewEdgeCalculator::NewEdgeCalculator(double Q, double edge_quasi_cutoff, double overlap, bool frameshift_merge, unordered_map<int, double>& simpson_map, double edge_quasi_cutoff_single, double overlap_single, double edge_quasi_cutoff_mixed, unsigned int maxPosition, bool noProb0) {
+NewEdgeCalculator::NewEdgeCalculator(double Q, double edge_quasi_cutoff, double overlap, bool frameshift_merge, unordered_map<int, double>& simpson_map, double edge_quasi_cutoff_single, double overlap_single, double edge_quasi_cutoff_mixed, unsigned int maxPosition, bool noProb0, double max_mismatch_rate) {
     this->Q = Q;
     this->EDGE_QUASI_CUTOFF = edge_quasi_cutoff;
     this->EDGE_QUASI_CUTOFF_SINGLE = edge_quasi_cutoff_single;
@@ -87,6 +87,7 @@ NewEdgeCalculator::NewEdgeCalculator(double Q, double edge_quasi_cutoff, double
         this->SIMPSON_MAP[k_v.first] = k_v.second;
     }
     this->NOPROB0 = noProb0;
+    this->MAX_MISMATCH_RATE = max_mismatch_rate;
 }
 
 NewEdgeCalculator::~NewEdgeCalculator() {
@@ -1262,7 +1263,6 @@ bool NewEdgeCalculator::edgeBetween(const AlignmentRecord & ap1, const Alignment
     unsigned int equalBase = 0;
     bool pe1 = ap1.isPairedEnd();
     bool pe2 = ap2.isPairedEnd();
-    aub.clear();
     
     // special cases of paired end reads for which no edge is allowed
     if (ap1.isSingleEnd() && ap2.isSingleEnd()){
@@ -1364,6 +1364,15 @@ bool NewEdgeCalculator::edgeBetween(const AlignmentRecord & ap1, const Alignment
         }
     }
     
+    // cheap upper bound on the dissimilarity of gap free reads before walking the cigar strings
+    if (MAX_MISMATCH_RATE < 1.0 && ap1.isIndelFree() && ap2.isIndelFree()) {
+        unsigned int overlap = 0;
+        unsigned int mismatches = ap1.countMismatches(ap2, overlap);
+        if (mismatches > MAX_MISMATCH_RATE * overlap) {
+            return false;
+        }
+    }
+
     if (checkGapsCigar(ap1, ap2, probM, prob0, cc, tc)) {
         return false;
     }
@@ -38,9 +38,9 @@ private:
     double EDGE_QUASI_CUTOFF;
     bool FRAMESHIFT_MERGE;
     bool NOPROB0;
+    double MAX_MISMATCH_RATE;
     //std::unordered_map<int, double> SIMPSON_MAP;
     std::vector<double> SIMPSON_MAP;
-    mutable std::vector<std::pair<int,int>> aub;
 
     void calculateProbM(const AlignmentRecord::mapValue &val1, const AlignmentRecord::mapValue &val2, double &res) const;
     void calculateProb0(const AlignmentRecord::mapValue &val1, double &res) const;
@@ -55,7 +55,7 @@ private:
     
 
 public:
-    NewEdgeCalculator(double Q, double edge_quasi_cutoff, double overlap, bool frameshift_merge, unordered_map<int, double>& simpson_map, double edge_quasi_cutoff_single, double overlap_single, double edge_quasi_cutoff_mixed, unsigned int maxPosition, bool noProb0);
+    NewEdgeCalculator(double Q, double edge_quasi_cutoff, double overlap, bool frameshift_merge, unordered_map<int, double>& simpson_map, double edge_quasi_cutoff_single, double overlap_single, double edge_quasi_cutoff_mixed, unsigned int maxPosition, bool noProb0, double max_mismatch_rate = 1.0);
     virtual ~NewEdgeCalculator();
 
     /** Decides whether an edge is to be drawn between the two given nodes. */
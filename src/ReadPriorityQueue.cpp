@@ -0,0 +1,55 @@
+#include <algorithm>
+
+#include "ReadPriorityQueue.h"
+
+using namespace std;
+
+ReadPriorityQueue::ReadPriorityQueue(unsigned int number_of_reads) : counts(number_of_reads, 0), heap(number_of_reads), heap_pos(number_of_reads) {
+	// with equal counts, ascending read ids already form a heap
+	for (unsigned int i=0; i<number_of_reads; ++i) {
+		heap[i] = i;
+		heap_pos[i] = i;
+	}
+}
+
+ReadPriorityQueue::~ReadPriorityQueue() {
+}
+
+void ReadPriorityQueue::swapHeap(size_t i, size_t j) {
+	swap(heap[i], heap[j]);
+	heap_pos[heap[i]] = i;
+	heap_pos[heap[j]] = j;
+}
+
+void ReadPriorityQueue::siftUp(size_t pos) {
+	while (pos > 0) {
+		size_t parent = (pos - 1) / 2;
+		if (!less(heap[pos], heap[parent])) break;
+		swapHeap(parent, pos);
+		pos = parent;
+	}
+}
+
+void ReadPriorityQueue::siftDown(size_t pos) {
+	while (true) {
+		size_t smallest = pos;
+		size_t left = 2 * pos + 1;
+		size_t right = left + 1;
+		if (left < heap.size() && less(heap[left], heap[smallest])) smallest = left;
+		if (right < heap.size() && less(heap[right], heap[smallest])) smallest = right;
+		if (smallest == pos) break;
+		swapHeap(pos, smallest);
+		pos = smallest;
+	}
+}
+
+void ReadPriorityQueue::increment(unsigned int read) {
+	counts[read] += 1;
+	siftDown(heap_pos[read]);
+}
+
+void ReadPriorityQueue::set(unsigned int read, unsigned int count) {
+	counts[read] = count;
+	siftDown(heap_pos[read]);
+	siftUp(heap_pos[read]);
+}
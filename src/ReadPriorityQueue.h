@@ -0,0 +1,33 @@
+#ifndef READPRIORITYQUEUE_H_
+#define READPRIORITYQUEUE_H_
+
+#include <vector>
+
+/** Usage counts of all reads in an indexed min-heap. top() returns the read with the
+ *  smallest count and, among those, the smallest read id, i.e. the first minimum of the
+ *  count vector. Changing the count of a read costs O(log n). */
+class ReadPriorityQueue {
+private:
+	std::vector<unsigned int> counts;
+	std::vector<unsigned int> heap;
+	std::vector<size_t> heap_pos;
+
+	bool less(unsigned int a, unsigned int b) const {
+		return counts[a] < counts[b] || (counts[a] == counts[b] && a < b);
+	}
+	void swapHeap(size_t i, size_t j);
+	void siftUp(size_t pos);
+	void siftDown(size_t pos);
+public:
+	/** creates the queue for reads 0 to number_of_reads-1, all with count zero. */
+	explicit ReadPriorityQueue(unsigned int number_of_reads);
+	virtual ~ReadPriorityQueue();
+
+	bool empty() const { return heap.empty(); }
+	unsigned int top() const { return heap[0]; }
+	unsigned int count(unsigned int read) const { return counts[read]; }
+	void increment(unsigned int read);
+	void set(unsigned int read, unsigned int count);
+};
+
+#endif /* READPRIORITYQUEUE_H_ */
@@ -19,6 +19,7 @@
 #ifndef THREADPOOL_H_
 #define THREADPOOL_H_
 
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <deque>
@@ -96,7 +97,7 @@ private:
 				if (job->id == parent->finished_job_count) {
 					for (size_t j=0; j<job->work_packages.size(); ++j) {
 						assert(job->work_packages[j] != 0);
-						parent->output_writer.write(std::auto_ptr<WorkPackageType>(job->work_packages[j]));
+						parent->output_writer.write(std::unique_ptr<WorkPackageType>(job->work_packages[j]));
 					}
 					parent->output_queue.pop();
 					delete job;
@@ -144,7 +145,7 @@ public:
 				throw std::runtime_error("Could not create mutex");
 			}
 			threads = new pthread_t[worker_thread_count];
-			for (size_t i=0; i<worker_thread_count; ++i) {
+			for (int i=0; i<worker_thread_count; ++i) {
 				if (pthread_create(threads+i, NULL, &thread_main, this)) {
 					throw std::runtime_error("Could not create thread");
 				}
@@ -166,8 +167,10 @@ public:
 			}
 			pthread_mutex_unlock(&queue_mutex);
 			for (int i=0; i<worker_thread_count; ++i) {
+				// a destructor cannot throw, and a thread that cannot be joined may still use the pool
 				if (pthread_join(threads[i], NULL)) {
-					throw std::runtime_error("Error during phtread_join");
+					std::cerr << "Error during pthread_join" << std::endl;
+					std::abort();
 				}
 			}
 			delete [] threads;
@@ -179,15 +182,15 @@ public:
 		}
 	}
 	
-	void addTask(std::auto_ptr<WorkPackageType> work_package) {
+	void addTask(std::unique_ptr<WorkPackageType> work_package) {
 		assert(work_package.get() != 0);
 		if (worker_thread_count == 0) {
 			work_package->run();
-			output_writer.write(work_package);
+			output_writer.write(std::move(work_package));
 		} else {
 			assert(new_job != 0);
 			new_job->work_packages.push_back(work_package.release());
-			if (new_job->work_packages.size() == job_size) {
+			if (new_job->work_packages.size() == (size_t)job_size) {
 				queue_job(new_job);
 				new_job = new job_t(queued_job_count);
 			}
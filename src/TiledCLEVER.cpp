@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+#include "TiledCLEVER.h"
+#include "CLEVER.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+namespace {
+
+/** a tile aims at this many reads per thread and tile; by default, tiles are never smaller than MIN_TILE_SIZE. */
+const size_t TILES_PER_THREAD = 4;
+const size_t MIN_TILE_SIZE = 500;
+
+/** clique found in a tile, its members are given by their index in the read stream. */
+struct TileClique {
+    std::vector<size_t> members;
+    std::unique_ptr<AlignmentRecord> super_read;
+    bool merged;
+};
+
+/** builds the super reads of a tile as soon as CLEVER reports the cliques. */
+class TileCollector : public CliqueCollector {
+private:
+    const std::vector<size_t>& stream_index;
+    std::vector<TileClique>& cliques;
+public:
+    TileCollector(const std::vector<size_t>& stream_index, std::vector<TileClique>& cliques) : CliqueCollector(nullptr), stream_index(stream_index), cliques(cliques) {}
+
+    void add(std::unique_ptr<Clique> clique) {
+        std::unique_ptr<std::vector<const AlignmentRecord*>> alignments = clique->getAllAlignments();
+        TileClique tile_clique;
+        for (const auto& a : *alignments) {
+            // CLEVER numbers the alignments of an iteration in the order they have been added
+            tile_clique.members.push_back(stream_index[a->getID()]);
+        }
+        tile_clique.merged = alignments->size() > 1;
+        if (tile_clique.merged) {
+            tile_clique.super_read.reset(new AlignmentRecord(alignments, 0));
+        } else {
+            AlignmentRecord* super_read = adopt(alignments->front());
+            tile_clique.super_read.reset(super_read != nullptr ? super_read : new AlignmentRecord(*(alignments->front())));
+        }
+        cliques.push_back(std::move(tile_clique));
+    }
+};
+
+/** work package running CLEVER on one tile. */
+class TileJob {
+public:
+    const EdgeCalculator& edge_calculator;
+    const EdgeCalculator* second_edge_calculator;
+    std::vector<AlignmentRecord*> alignments;
+    std::vector<size_t> stream_index;
+    /** number of leading alignments that are shared with the previous tile. */
+    size_t shared;
+    std::vector<TileClique> cliques;
+    int edges;
+    bool converged;
+
+    unsigned int max_active_cliques;
+    unsigned int beam_width;
+    size_t max_active_bytes;
+
+    TileJob(const EdgeCalculator& edge_calculator, const EdgeCalculator* second_edge_calculator, unsigned int max_active_cliques, unsigned int beam_width, size_t max_active_bytes) : edge_calculator(edge_calculator), second_edge_calculator(second_edge_calculator), shared(0), edges(0), converged(true), max_active_cliques(max_active_cliques), beam_width(beam_width), max_active_bytes(max_active_bytes) {}
+
+    ~TileJob() {
+        for (auto&& a : alignments) delete a;
+    }
+
+    void run() {
+        TileCollector collector(stream_index, cliques);
+        CLEVER clever(edge_calculator, collector, nullptr, 0, 0, 0, false);
+        clever.setActiveCliqueLimit(max_active_cliques, beam_width, max_active_bytes);
+        if (second_edge_calculator != nullptr) {
+            clever.setSecondEdgeCalculator(second_edge_calculator);
+        }
+        clever.initialize();
+        // edges among shared alignments have already been counted by the previous tile
+        int shared_edges = 0;
+        for (size_t i=0; i<alignments.size(); ++i) {
+            unique_ptr<AlignmentRecord> al_ptr(alignments[i]);
+            alignments[i] = nullptr;
+            clever.addAlignment(al_ptr, (i < shared) ? shared_edges : edges);
+        }
+        alignments.clear();
+        clever.finish();
+        converged = clever.hasConverged();
+    }
+};
+
+/** keeps finished tiles in tile order. */
+class TileWriter {
+public:
+    std::vector<std::unique_ptr<TileJob>> tiles;
+    void write(std::unique_ptr<TileJob> tile) {
+        tiles.push_back(std::move(tile));
+    }
+};
+
+/** returns true if all members of the clique are contained in the sorted vector reads. */
+bool onlyContains(const TileClique& clique, const std::vector<size_t>& reads) {
+    for (size_t m : clique.members) {
+        if (!binary_search(reads.begin(), reads.end(), m)) return false;
+    }
+    return true;
+}
+
+/** indexes the cliques by their members that are contained in reads. */
+std::unordered_map<size_t, std::vector<size_t>> indexByRead(const std::vector<TileClique>& cliques, const std::vector<size_t>& reads) {
+    std::unordered_map<size_t, std::vector<size_t>> index;
+    for (size_t c=0; c<cliques.size(); ++c) {
+        for (size_t m : cliques[c].members) {
+            if (binary_search(reads.begin(), reads.end(), m)) index[m].push_back(c);
+        }
+    }
+    return index;
+}
+
+}
+
+TiledCLEVER::TiledCLEVER(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, unsigned int threads) : CliqueFinder(edge_calculator, clique_collector), threads(threads), min_tile_size(MIN_TILE_SIZE), max_active_cliques(0), beam_width(0), max_active_bytes(0), edgecounter(nullptr) {
+}
+
+void TiledCLEVER::setMinTileSize(size_t min_tile_size) {
+    this->min_tile_size = min_tile_size;
+}
+
+void TiledCLEVER::setActiveCliqueLimit(unsigned int max_active_cliques, unsigned int beam_width, size_t max_active_bytes) {
+    this->max_active_cliques = max_active_cliques;
+    this->beam_width = beam_width;
+    this->max_active_bytes = max_active_bytes;
+}
+
+TiledCLEVER::~TiledCLEVER() {
+    for (auto&& a : alignments) delete a;
+}
+
+void TiledCLEVER::initialize() {
+    for (auto&& a : alignments) delete a;
+    alignments.clear();
+    alignment_count = 0;
+    edgecounter = nullptr;
+    converged = true;
+    initialized = true;
+}
+
+void TiledCLEVER::addAlignment(std::unique_ptr<AlignmentRecord>& alignment_autoptr, int& edgecounter) {
+    assert(alignment_autoptr.get() != 0);
+    assert(initialized);
+    // edges are only known after finish(), which adds them to the counter passed here
+    this->edgecounter = &edgecounter;
+    alignments.push_back(alignment_autoptr.release());
+    alignment_count += 1;
+}
+
+vector<size_t> TiledCLEVER::findBreakpoints() const {
+    vector<size_t> breakpoints(1, 0);
+    size_t n = alignments.size();
+    size_t target = max(min_tile_size, n / (threads * TILES_PER_THREAD));
+    if (n < 2 * target) return breakpoints;
+    unsigned int max_span = 0;
+    for (const auto& a : alignments) {
+        max_span = max(max_span, a->getIntervalEnd() - a->getIntervalStart());
+    }
+    // ends of the reads left of the current read that may still cover it
+    priority_queue<unsigned int, vector<unsigned int>, greater<unsigned int> > ends;
+    size_t tile_start = 0;
+    unsigned int tile_position = alignments[0]->getIntervalStart();
+    size_t best = 0;
+    size_t best_crossing = 0;
+    for (size_t i=1; i<n; ++i) {
+        unsigned int position = alignments[i]->getIntervalStart();
+        unsigned int previous = alignments[i-1]->getIntervalStart();
+        ends.push(alignments[i-1]->getIntervalEnd());
+        // tiles rely on reads being sorted by position
+        if (position < previous) return vector<size_t>(1, 0);
+        if (position == previous) continue;
+        while (!ends.empty() && ends.top() < position) ends.pop();
+        // a read may cross at most one cut, which is guaranteed if tiles are wider than all reads
+        if (i - tile_start < target || position <= tile_position + max_span) continue;
+        // among the cuts within half a tile beyond the target size, take the one crossed by the fewest reads
+        if (best == 0 || ends.size() < best_crossing) {
+            best = i;
+            best_crossing = ends.size();
+        }
+        if (i - tile_start >= target + target / 2) {
+            breakpoints.push_back(best);
+            tile_start = best;
+            tile_position = alignments[best]->getIntervalStart();
+            best = 0;
+        }
+    }
+    if (best != 0 && n - best >= target / 2) {
+        breakpoints.push_back(best);
+    }
+    return breakpoints;
+}
+
+void TiledCLEVER::finish() {
+    assert(initialized);
+    vector<size_t> breakpoints = findBreakpoints();
+    size_t tile_count = breakpoints.size();
+    breakpoints.push_back(alignments.size());
+    if (tile_count == 1) {
+        // a single tile is a plain sweep, whose large clique updates may still use all threads
+        CLEVER clever(edge_calculator, clique_collector, nullptr, 0, 0, 0, false);
+        clever.setThreads(threads);
+        clever.setActiveCliqueLimit(max_active_cliques, beam_width, max_active_bytes);
+        if (second_edge_calculator != nullptr) {
+            clever.setSecondEdgeCalculator(second_edge_calculator);
+        }
+        clever.initialize();
+        for (size_t i=0; i<alignments.size(); ++i) {
+            unique_ptr<AlignmentRecord> al_ptr(alignments[i]);
+            alignments[i] = nullptr;
+            clever.addAlignment(al_ptr, *edgecounter);
+        }
+        alignments.clear();
+        clever.finish();
+        converged = clever.hasConverged();
+        initialized = false;
+        return;
+    }
+
+    // crossing[k] holds the reads that cross the cut between tile k-1 and tile k. They are
+    // copied for tile k before any tile runs, since CLEVER deletes alignments it is done with.
+    vector<vector<size_t> > crossing(tile_count);
+    vector<TileJob*> tiles;
+    for (size_t k=0; k<tile_count; ++k) {
+        TileJob* tile = new TileJob(edge_calculator, second_edge_calculator, max_active_cliques, beam_width, max_active_bytes);
+        if (k > 0) {
+            unsigned int cut = alignments[breakpoints[k]]->getIntervalStart();
+            for (size_t j=breakpoints[k-1]; j<breakpoints[k]; ++j) {
+                if (alignments[j]->getIntervalEnd() >= cut) crossing[k].push_back(j);
+            }
+            for (size_t j : crossing[k]) {
+                tile->alignments.push_back(new AlignmentRecord(*alignments[j]));
+                tile->stream_index.push_back(j);
+            }
+            tile->shared = crossing[k].size();
+        }
+        for (size_t j=breakpoints[k]; j<breakpoints[k+1]; ++j) {
+            tile->alignments.push_back(alignments[j]);
+            tile->stream_index.push_back(j);
+        }
+        tiles.push_back(tile);
+    }
+    TileWriter writer;
+    {
+        ThreadPool<TileJob, TileWriter> pool(min((size_t)threads, tile_count), 1, threads, writer);
+        for (auto&& tile : tiles) {
+            pool.addTask(std::unique_ptr<TileJob>(tile));
+        }
+    }
+    // all alignments are owned by the tiles now
+    alignments.clear();
+    assert(writer.tiles.size() == tile_count);
+
+    // reconcile cliques that consist of crossing reads only; a clique found on both sides
+    // is kept in the left tile and a clique contained in a clique of the other tile is dropped
+    vector<vector<bool> > dropped(tile_count);
+    for (size_t k=0; k<tile_count; ++k) {
+        dropped[k].assign(writer.tiles[k]->cliques.size(), false);
+    }
+    for (size_t k=1; k<tile_count; ++k) {
+        const vector<TileClique>& left_cliques = writer.tiles[k-1]->cliques;
+        const vector<TileClique>& right_cliques = writer.tiles[k]->cliques;
+        std::unordered_map<size_t, vector<size_t> > left_by_read = indexByRead(left_cliques, crossing[k]);
+        std::unordered_map<size_t, vector<size_t> > right_by_read = indexByRead(right_cliques, crossing[k]);
+        for (size_t c=0; c<right_cliques.size(); ++c) {
+            if (!onlyContains(right_cliques[c], crossing[k])) continue;
+            for (size_t l : left_by_read[right_cliques[c].members[0]]) {
+                if (includes(left_cliques[l].members.begin(), left_cliques[l].members.end(), right_cliques[c].members.begin(), right_cliques[c].members.end())) {
+                    dropped[k][c] = true;
+                    break;
+                }
+            }
+        }
+        for (size_t c=0; c<left_cliques.size(); ++c) {
+            if (!onlyContains(left_cliques[c], crossing[k])) continue;
+            for (size_t r : right_by_read[left_cliques[c].members[0]]) {
+                if (right_cliques[r].members.size() > left_cliques[c].members.size() && includes(right_cliques[r].members.begin(), right_cliques[r].members.end(), left_cliques[c].members.begin(), left_cliques[c].members.end())) {
+                    dropped[k-1][c] = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (size_t k=0; k<tile_count; ++k) {
+        TileJob& tile = *writer.tiles[k];
+        for (size_t c=0; c<tile.cliques.size(); ++c) {
+            if (dropped[k][c]) continue;
+            clique_collector.addSuperRead(std::move(tile.cliques[c].super_read), tile.cliques[c].merged);
+        }
+        *edgecounter += tile.edges;
+        converged = converged && tile.converged;
+    }
+    initialized = false;
+}
@@ -0,0 +1,43 @@
+#ifndef TILEDCLEVER_H_
+#define TILEDCLEVER_H_
+
+#include <vector>
+
+#include "CliqueFinder.h"
+
+/** Runs CLEVER on overlapping tiles of the read stream in parallel. Tiles are cut at
+ *  positions covered by few reads; reads crossing a cut are given to both tiles. Since
+ *  all reads of a clique share a position, every maximal clique is found within one tile.
+ *  Cliques of a tile that consist of crossing reads only are compared against the other
+ *  tile, where they are either found again or turn out not to be maximal. The resulting
+ *  set of cliques equals the one of a single CLEVER sweep. */
+class TiledCLEVER : public CliqueFinder {
+private:
+    unsigned int threads;
+    size_t min_tile_size;
+    unsigned int max_active_cliques;
+    unsigned int beam_width;
+    size_t max_active_bytes;
+    std::vector<AlignmentRecord*> alignments;
+    int* edgecounter;
+public:
+    TiledCLEVER(const EdgeCalculator& edge_calculator, CliqueCollector& clique_collector, unsigned int threads);
+    virtual ~TiledCLEVER();
+    const AlignmentRecord & getAlignmentByIndex(size_t index) const {
+        assert(index<alignment_count);
+    	return *(alignments[index]);
+    }
+    /** sets the number of reads below which a tile is not cut, mainly to test tiling on small inputs. */
+    void setMinTileSize(size_t min_tile_size);
+    /** returns the read indices at which tiles start, the first one being 0. */
+    std::vector<size_t> findBreakpoints() const;
+    /** see CLEVER::setActiveCliqueLimit(), applies to every tile. */
+    void setActiveCliqueLimit(unsigned int max_active_cliques, unsigned int beam_width, size_t max_active_bytes);
+    void initialize();
+    /** collects the alignment, the cliques are computed by finish(). */
+    void addAlignment(std::unique_ptr<AlignmentRecord>& ap, int& edgecounter);
+    /** computes the cliques of all tiles and adds the reconciled cliques to clique_collector. */
+    void finish();
+};
+
+#endif /* TILEDCLEVER_H_ */
@@ -19,6 +19,9 @@
 #ifndef TYPES_H_
 #define TYPES_H_
 
+#include <cstdint>
+#include <cstddef>
+
 #include <boost/dynamic_bitset.hpp>
 
 typedef unsigned int alignment_id_t;
@@ -31,4 +34,29 @@ typedef struct mean_and_stddev_t {
 	mean_and_stddev_t(double mean, double stddev) : mean(mean), stddev(stddev) {}
 } mean_and_stddev_t;
 
+/** order independent 128 bit hash of a set of original read ids. Two sets are treated
+ *  as equal if their fingerprints are; every id has to be added only once. */
+typedef struct read_set_fingerprint_t {
+	uint64_t low;
+	uint64_t high;
+	read_set_fingerprint_t() : low(0), high(0) {}
+	void add(int read) {
+		low += mix(static_cast<uint64_t>(read) + 0x9e3779b97f4a7c15ULL);
+		high += mix(static_cast<uint64_t>(read) ^ 0xc2b2ae3d27d4eb4fULL);
+	}
+	bool operator==(const read_set_fingerprint_t& other) const { return low == other.low && high == other.high; }
+	bool operator!=(const read_set_fingerprint_t& other) const { return !(*this == other); }
+	bool operator<(const read_set_fingerprint_t& other) const { return low < other.low || (low == other.low && high < other.high); }
+	/** splitmix64 finalizer. */
+	static uint64_t mix(uint64_t x) {
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+} read_set_fingerprint_t;
+
+struct read_set_fingerprint_hash {
+	size_t operator()(const read_set_fingerprint_t& f) const { return static_cast<size_t>(f.low ^ (f.high * 0x9e3779b97f4a7c15ULL)); }
+};
+
 #endif /* TYPES_H_ */
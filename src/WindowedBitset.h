@@ -0,0 +1,169 @@
+#ifndef WINDOWEDBITSET_H_
+#define WINDOWEDBITSET_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+/** A set of alignment indices that only stores the blocks between the lowest and
+ *  the highest member. Operations on two sets touch only the blocks where both
+ *  windows overlap; everything outside a window is implicitly zero. */
+class WindowedBitset {
+public:
+	typedef uint64_t block_type;
+	static const size_t bits_per_block = 64;
+	static const size_t npos = (size_t)-1;
+private:
+	size_t first_block;
+	std::vector<block_type> blocks;
+
+	/** returns block number b (absolute), zero outside the window. */
+	block_type block(size_t b) const {
+		if (b < first_block || b >= first_block + blocks.size()) return 0;
+		return blocks[b - first_block];
+	}
+	/** drops zero blocks at both ends of the window. */
+	void trim() {
+		size_t lead = 0;
+		while (lead < blocks.size() && blocks[lead] == 0) ++lead;
+		if (lead == blocks.size()) {
+			blocks.clear();
+			first_block = 0;
+			return;
+		}
+		size_t end = blocks.size();
+		while (blocks[end - 1] == 0) --end;
+		blocks.erase(blocks.begin() + end, blocks.end());
+		blocks.erase(blocks.begin(), blocks.begin() + lead);
+		first_block += lead;
+	}
+	/** extends the window such that it contains block b. */
+	void cover(size_t b) {
+		if (blocks.empty()) {
+			first_block = b;
+			blocks.push_back(0);
+		} else if (b < first_block) {
+			blocks.insert(blocks.begin(), first_block - b, 0);
+			first_block = b;
+		} else if (b >= first_block + blocks.size()) {
+			blocks.resize(b - first_block + 1, 0);
+		}
+	}
+public:
+	WindowedBitset() : first_block(0) {}
+	/** creates the set {index}. */
+	explicit WindowedBitset(size_t index) : first_block(index / bits_per_block), blocks(1, (block_type)1 << (index % bits_per_block)) {}
+	/** creates an empty set whose window covers the indices first to last. */
+	WindowedBitset(size_t first, size_t last) : first_block(first / bits_per_block), blocks(last / bits_per_block - first / bits_per_block + 1, 0) {}
+
+	void set(size_t index) {
+		size_t b = index / bits_per_block;
+		cover(b);
+		blocks[b - first_block] |= (block_type)1 << (index % bits_per_block);
+	}
+	bool test(size_t index) const {
+		return (block(index / bits_per_block) >> (index % bits_per_block)) & 1;
+	}
+	bool any() const {
+		for (block_type w : blocks) {
+			if (w != 0) return true;
+		}
+		return false;
+	}
+	/** returns the number of blocks the window stores. */
+	size_t blockCount() const { return blocks.size(); }
+	size_t count() const {
+		size_t n = 0;
+		for (block_type w : blocks) n += __builtin_popcountll(w);
+		return n;
+	}
+	/** returns the size of the intersection with other without building it. */
+	size_t intersectCount(const WindowedBitset& other) const {
+		size_t begin = std::max(first_block, other.first_block);
+		size_t end = std::min(first_block + blocks.size(), other.first_block + other.blocks.size());
+		size_t n = 0;
+		for (size_t b = begin; b < end; ++b) {
+			n += __builtin_popcountll(blocks[b - first_block] & other.blocks[b - other.first_block]);
+		}
+		return n;
+	}
+	bool isSubsetOf(const WindowedBitset& other) const {
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			if ((blocks[i] & ~other.block(first_block + i)) != 0) return false;
+		}
+		return true;
+	}
+	/** returns the intersection with other, its window is shrunk to the members. */
+	WindowedBitset intersection(const WindowedBitset& other) const {
+		WindowedBitset result;
+		size_t begin = std::max(first_block, other.first_block);
+		size_t end = std::min(first_block + blocks.size(), other.first_block + other.blocks.size());
+		if (begin >= end) return result;
+		result.first_block = begin;
+		result.blocks.resize(end - begin);
+		for (size_t b = begin; b < end; ++b) {
+			result.blocks[b - begin] = blocks[b - first_block] & other.blocks[b - other.first_block];
+		}
+		result.trim();
+		return result;
+	}
+	WindowedBitset& operator|=(const WindowedBitset& other) {
+		if (other.blocks.empty()) return *this;
+		cover(other.first_block);
+		cover(other.first_block + other.blocks.size() - 1);
+		for (size_t i = 0; i < other.blocks.size(); ++i) {
+			blocks[other.first_block + i - first_block] |= other.blocks[i];
+		}
+		return *this;
+	}
+	bool operator==(const WindowedBitset& other) const {
+		size_t begin = std::min(first_block, other.first_block);
+		size_t end = std::max(first_block + blocks.size(), other.first_block + other.blocks.size());
+		for (size_t b = begin; b < end; ++b) {
+			if (block(b) != other.block(b)) return false;
+		}
+		return true;
+	}
+	size_t findFirst() const {
+		for (size_t i = 0; i < blocks.size(); ++i) {
+			if (blocks[i] != 0) return (first_block + i) * bits_per_block + __builtin_ctzll(blocks[i]);
+		}
+		return npos;
+	}
+	/** returns the largest member or npos. */
+	size_t findLast() const {
+		for (size_t i = blocks.size(); i > 0; --i) {
+			if (blocks[i - 1] != 0) return (first_block + i) * bits_per_block - 1 - __builtin_clzll(blocks[i - 1]);
+		}
+		return npos;
+	}
+	/** returns the OR of all blocks. If a is a subset of b, then the signature
+	 *  of a is a subset of the signature of b. */
+	block_type signature() const {
+		block_type sig = 0;
+		for (block_type w : blocks) sig |= w;
+		return sig;
+	}
+	/** returns the smallest member larger than index or npos. */
+	size_t findNext(size_t index) const {
+		size_t b = index / bits_per_block;
+		size_t offset = index % bits_per_block;
+		if (b < first_block) return findFirst();
+		if (b >= first_block + blocks.size()) return npos;
+		block_type w = (offset + 1 < bits_per_block) ? blocks[b - first_block] >> (offset + 1) << (offset + 1) : 0;
+		for (size_t i = b - first_block; ; ) {
+			if (w != 0) return (first_block + i) * bits_per_block + __builtin_ctzll(w);
+			if (++i >= blocks.size()) return npos;
+			w = blocks[i];
+		}
+	}
+	/** first block of the window, blocks below are empty. */
+	size_t firstBlock() const { return first_block; }
+	/** block after the window, blocks from here on are empty. */
+	size_t endBlock() const { return first_block + blocks.size(); }
+	/** returns block b of the set (absolute numbering), zero outside the window. */
+	block_type getBlock(size_t b) const { return block(b); }
+};
+
+#endif /* WINDOWEDBITSET_H_ */
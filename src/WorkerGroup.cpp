@@ -0,0 +1,90 @@
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include "WorkerGroup.h"
+
+using namespace std;
+
+WorkerGroup::WorkerGroup(int worker_thread_count) : worker_thread_count(worker_thread_count), generation(0), stop(false), task(nullptr), task_count(0), next_task(0), finished_tasks(0) {
+	assert(worker_thread_count >= 0);
+	if (pthread_mutex_init(&mutex, NULL)) {
+		throw std::runtime_error("Could not create mutex");
+	}
+	if (pthread_cond_init(&start_condition, NULL) || pthread_cond_init(&done_condition, NULL)) {
+		throw std::runtime_error("Could not create condition variable");
+	}
+	threads = new pthread_t[worker_thread_count];
+	for (int i=0; i<worker_thread_count; ++i) {
+		if (pthread_create(threads+i, NULL, &thread_main, this)) {
+			throw std::runtime_error("Could not create thread");
+		}
+	}
+}
+
+WorkerGroup::~WorkerGroup() {
+	pthread_mutex_lock(&mutex);
+	stop = true;
+	pthread_cond_broadcast(&start_condition);
+	pthread_mutex_unlock(&mutex);
+	for (int i=0; i<worker_thread_count; ++i) {
+		// a destructor cannot throw, and a thread that cannot be joined may still use the group
+		if (pthread_join(threads[i], NULL)) {
+			cerr << "Error during pthread_join" << endl;
+			abort();
+		}
+	}
+	delete [] threads;
+	pthread_cond_destroy(&start_condition);
+	pthread_cond_destroy(&done_condition);
+	pthread_mutex_destroy(&mutex);
+}
+
+void WorkerGroup::work() {
+	while (next_task < task_count) {
+		size_t i = next_task++;
+		pthread_mutex_unlock(&mutex);
+		(*task)(i);
+		pthread_mutex_lock(&mutex);
+		finished_tasks += 1;
+		if (finished_tasks == task_count) {
+			pthread_cond_signal(&done_condition);
+		}
+	}
+}
+
+void* WorkerGroup::thread_main(void* p) {
+	assert(p != 0);
+	WorkerGroup* group = (WorkerGroup*)p;
+	long long seen_generation = 0;
+	pthread_mutex_lock(&group->mutex);
+	while (true) {
+		while (!group->stop && group->generation == seen_generation) {
+			pthread_cond_wait(&group->start_condition, &group->mutex);
+		}
+		if (group->stop) break;
+		seen_generation = group->generation;
+		group->work();
+	}
+	pthread_mutex_unlock(&group->mutex);
+	return NULL;
+}
+
+void WorkerGroup::run(size_t count, const std::function<void(size_t)>& task) {
+	if (count == 0) return;
+	pthread_mutex_lock(&mutex);
+	this->task = &task;
+	task_count = count;
+	next_task = 0;
+	finished_tasks = 0;
+	generation += 1;
+	pthread_cond_broadcast(&start_condition);
+	work();
+	while (finished_tasks < task_count) {
+		pthread_cond_wait(&done_condition, &mutex);
+	}
+	this->task = nullptr;
+	task_count = 0;
+	pthread_mutex_unlock(&mutex);
+}
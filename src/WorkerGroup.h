@@ -0,0 +1,40 @@
+#ifndef WORKERGROUP_H_
+#define WORKERGROUP_H_
+
+#include <functional>
+
+#include <pthread.h>
+
+/** A fixed group of threads for fork-join loops. In contrast to ThreadPool, the threads
+ *  are kept between calls of run(), so that short parallel sections can be executed
+ *  many times without creating threads. */
+class WorkerGroup {
+private:
+	int worker_thread_count;
+	pthread_t* threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t start_condition;
+	pthread_cond_t done_condition;
+	/** increased with every call of run(), tells waiting threads that there is new work. */
+	long long generation;
+	bool stop;
+	const std::function<void(size_t)>* task;
+	size_t task_count;
+	size_t next_task;
+	size_t finished_tasks;
+
+	static void* thread_main(void* p);
+	/** executes tasks until none is left, mutex must be held by the caller. */
+	void work();
+public:
+	WorkerGroup(int worker_thread_count);
+	virtual ~WorkerGroup();
+
+	/** calls task(i) for i in 0..count-1 on the worker threads and the calling thread
+	 *  and returns once all calls have finished. */
+	void run(size_t count, const std::function<void(size_t)>& task);
+	/** number of threads taking part in run(), including the calling one. */
+	int size() const { return worker_thread_count + 1; }
+};
+
+#endif /* WORKERGROUP_H_ */
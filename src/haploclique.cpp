@@ -27,6 +27,7 @@
 #include <ctime>
 #include <algorithm>
 #include <deque>
+#include <functional>
 
 #include "docopt/docopt.h"
 
@@ -42,7 +43,10 @@
 #include "NewEdgeCalculator.h"
 #include "CliqueFinder.h"
 #include "CLEVER.h"
+#include "TiledCLEVER.h"
 #include "BronKerbosch.h"
+#include "GreedyCliqueCover.h"
+#include "GraphProfile.h"
 #include "CliqueCollector.h"
 #include "AnyDistributionEdgeCalculator.h"
 #include "GaussianEdgeCalculator.h"
@@ -56,10 +60,16 @@ R"(haploclique predicts haplotypes from NGS reads.
 
 Usage:
   haploclique bronkerbosch [options] [--] <bamfile> [<output>]
+  haploclique greedy [options] [--] <bamfile> [<output>]
+  haploclique auto [options] [--] <bamfile> [<output>]
   haploclique [options] [--] <bamfile> [<output>]
 
   clever        use the original clever clique finder
   bronkerbosch  use the Bron-Kerbosch based clique finder
+  greedy        cover all reads by greedily grown cliques instead of
+                enumerating all maximal cliques (fast screening)
+  auto          choose between clever and bronkerbosch in every iteration
+                from statistics of the first reads, see stderr
 
 Options:
   -q NUM --edge_quasi_cutoff_cliques=NUM  edge calculator option
@@ -105,6 +115,69 @@ Options:
   -mc NUM --max_cliques=NUM                Set a threshold for the maximal number of cliques which
                                            should be considered in the next iteration.
   -lc NUM --limit_clique_size=NUM          Set a threshold to limit the size of cliques.
+  --umi_tag=TAG                            Fold reads with the same UMI in aux tag TAG
+                                           (e.g. RX) and the same mapping position into
+                                           one consensus read. Frequencies count
+                                           molecules instead of reads.
+  --collapse_duplicates                    Merge reads with identical position, cigar and
+                                           sequence into one vertex before the first
+                                           iteration.
+  --duplicate_quality_bins=NUM             Width of the phred score bins in which the
+                                           qualities of duplicates have to agree.
+                                           [default: 1]
+  --prune_contained                        Fold super reads that lie within a longer super
+                                           read and agree with it on every shared base into
+                                           that read before the next iteration.
+  --max_mismatch_rate=NUM                  Do not draw edges between reads without indels
+                                           whose overlap has a larger fraction of
+                                           mismatching bases. [default: 1.0]
+  --threads=NUM                            Split the reads into tiles at positions of low
+                                           coverage and find the cliques of the tiles on
+                                           NUM threads. Without tiling (together with
+                                           max_cliques, limit_clique_size or log), threads
+                                           only share the update of many active cliques.
+                                           With bronkerbosch, the subproblems of the
+                                           enumeration are run on NUM threads. Without
+                                           log, super reads are merged on NUM threads.
+                                           [default: 1]
+  --max_active_cliques=NUM                 Budget of cliques CLEVER keeps active at a time.
+                                           Where it is exceeded, only the best supported
+                                           cliques are extended until the region is passed,
+                                           the others are reported as they are; such
+                                           regions are reported. 0 means no budget.
+                                           [default: 0]
+  --max_active_clique_bytes=NUM            Budget of the estimated memory in bytes of the
+                                           cliques CLEVER keeps active at a time, handled
+                                           like max_active_cliques. 0 means no budget.
+                                           [default: 0]
+  --beam_width=NUM                         Number of cliques kept in regions exceeding
+                                           max_active_cliques or max_active_clique_bytes.
+                                           [default: 1000]
+  --stream_components                      Let bronkerbosch enumerate every connected
+                                           component of the read graph as soon as all of
+                                           its reads have been passed and free it. Cliques
+                                           are then reported component by component.
+  --memoize_cliques                        Keep one super read per set of original reads
+                                           in every iteration. A clique with a member that
+                                           holds all of its original reads reuses that
+                                           super read of the previous iteration instead of
+                                           merging the clique again. This approximates the
+                                           merge, the other members are not folded in.
+  --convergence_threshold=NUM              Stop as soon as the fraction of super reads that
+                                           did not exist in the previous iteration with the
+                                           same original reads, positions, sequences,
+                                           qualities and cigar strings is at most NUM. 0 stops once
+                                           the super reads stay the same, a negative value
+                                           disables the check. Not checked before the
+                                           filters of iterations 1 and 2 have run.
+                                           [default: 0.0]
+  --incremental                            Pass super reads that had no edges in the
+                                           previous iteration and do not overlap any new
+                                           super read on to the next iteration without
+                                           searching cliques among them again. Not used
+                                           with greedy, max_cliques, limit_clique_size,
+                                           max_active_cliques, max_active_clique_bytes,
+                                           prune_contained or log.
 
 )";
 
@@ -134,8 +207,60 @@ bool read_mean_and_sd(const string& filename, double* mean, double* sd) {
     }
     return true;
 }
+/** fingerprint of the read set of a super read together with the hash of its content. */
+typedef pair<read_set_fingerprint_t, uint64_t> super_read_fingerprint_t;
+/** returns the sorted fingerprints of all super reads. Two super reads only match if they stand for
+ *  the same reads and agree in positions, sequences, qualities and cigar strings. */
+vector<super_read_fingerprint_t> fingerprintReads(const deque<AlignmentRecord*>& reads) {
+    vector<super_read_fingerprint_t> fingerprints;
+    fingerprints.reserve(reads.size());
+    for (const auto& read : reads) {
+        fingerprints.emplace_back(read->getFingerprint(), read->getContentHash());
+    }
+    sort(fingerprints.begin(), fingerprints.end());
+    return fingerprints;
+}
+/** returns the number of fingerprints in current that are missing in previous, both sorted. */
+size_t countChanged(const vector<super_read_fingerprint_t>& previous, const vector<super_read_fingerprint_t>& current) {
+    size_t changed = 0;
+    auto it = previous.begin();
+    for (const auto& fingerprint : current) {
+        while (it != previous.end() && *it < fingerprint) ++it;
+        if (it != previous.end() && *it == fingerprint) {
+            ++it;
+        } else {
+            ++changed;
+        }
+    }
+    return changed;
+}
+/** marks the reads that are settled super reads of the last iteration and do not overlap any read
+ *  that is neither settled nor skipped. Settled reads had no edges among each other, so the
+ *  marked reads form singleton cliques again. reads have to be sorted by interval start. */
+vector<bool> findCarriedReads(const deque<AlignmentRecord*>& reads, const CliqueCollector& collector, const std::function<bool(const AlignmentRecord&)>& skip) {
+    vector<bool> settled(reads.size());
+    // interval starts and running maximum of the interval ends of the changed reads
+    vector<unsigned int> starts;
+    vector<unsigned int> max_ends;
+    for (size_t i = 0; i < reads.size(); ++i) {
+        settled[i] = collector.isSettled(reads[i]);
+        if (settled[i] || skip(*reads[i])) continue;
+        starts.push_back(reads[i]->getIntervalStart());
+        max_ends.push_back(max(reads[i]->getIntervalEnd(), max_ends.empty() ? 0 : max_ends.back()));
+    }
+    vector<bool> carried(reads.size(), false);
+    for (size_t i = 0; i < reads.size(); ++i) {
+        if (!settled[i]) continue;
+        unsigned int start = reads[i]->getIntervalStart();
+        size_t next = upper_bound(starts.begin(), starts.end(), start) - starts.begin();
+        if (next > 0 && max_ends[next-1] >= start) continue;
+        if (next < starts.size() && starts[next] <= reads[i]->getIntervalEnd()) continue;
+        carried[i] = true;
+    }
+    return carried;
+}
 /** reads BamFile */
-deque<AlignmentRecord*>* readBamFile(string filename, vector<string>& readNames, unsigned int& max_position, BamTools::SamHeader& header, BamTools::RefVector& references) {
+deque<AlignmentRecord*>* readBamFile(string filename, vector<string>& readNames, unsigned int& max_position, BamTools::SamHeader& header, BamTools::RefVector& references, const string& umi_tag = "") {
     // readNames will contain original read names (not id which is set by addAlignment in CLEVER.cpp)
     typedef std::unordered_map<std::string, AlignmentRecord*> name_map_t;
     name_map_t names_to_reads;
@@ -163,7 +288,12 @@ deque<AlignmentRecord*>* readBamFile(string filename, vector<string>& readNames,
                 reads->push_back(names_to_reads[alignment.Name]);
                 names_to_reads.erase(alignment.Name);
             } else {
-                names_to_reads[alignment.Name] = new AlignmentRecord(alignment, readNames.size(), &readNames);
+                AlignmentRecord* record = new AlignmentRecord(alignment, readNames.size(), &readNames);
+                string umi;
+                if (!umi_tag.empty() && alignment.GetTag(umi_tag, umi)) {
+                    record->setUmi(umi);
+                }
+                names_to_reads[alignment.Name] = record;
                 readNames.push_back(alignment.Name);
             }
         }
@@ -241,9 +371,28 @@ int main(int argc, char* argv[]) {
     if (args["--max_cliques"]) max_cliques = stoi(args["--max_cliques"].asString());
     int limit_clique_size = 0;
     if (args["--limit_clique_size"]) limit_clique_size = stoi(args["--limit_clique_size"].asString());
+    double max_mismatch_rate = stod(args["--max_mismatch_rate"].asString());
+    string umi_tag = "";
+    if (args["--umi_tag"]) umi_tag = args["--umi_tag"].asString();
+    bool collapse_duplicates = args["--collapse_duplicates"].asBool();
+    bool prune_contained = args["--prune_contained"].asBool();
+    int duplicate_quality_bins = stoi(args["--duplicate_quality_bins"].asString());
+    int threads = stoi(args["--threads"].asString());
+    int max_active_cliques = stoi(args["--max_active_cliques"].asString());
+    size_t max_active_clique_bytes = stoull(args["--max_active_clique_bytes"].asString());
+    int beam_width = stoi(args["--beam_width"].asString());
+    bool stream_components = args["--stream_components"].asBool();
+    bool memoize_cliques = args["--memoize_cliques"].asBool();
+    double convergence_threshold = stod(args["--convergence_threshold"].asString());
+    bool incremental = args["--incremental"].asBool();
 
     // END PARAMETERS
 
+    if ((max_active_cliques > 0 || max_active_clique_bytes > 0) && beam_width <= 0) {
+        cerr << "Error: --beam_width must be positive." << endl;
+        return 1;
+    }
+
     bool call_indels = indel_output_file.size() > 0;
     if (call_indels && (mean_and_sd_filename.size() == 0)) {
         cerr << "Error: when using option -I, option -M must also be given." << endl;
@@ -281,7 +430,7 @@ int main(int argc, char* argv[]) {
 
     deque<AlignmentRecord*>* reads;
     try{
-        reads = readBamFile(bamfile, original_read_names,max_position1,header,references);
+        reads = readBamFile(bamfile, original_read_names,max_position1,header,references,umi_tag);
     }
     catch(const runtime_error& error){
         cerr << error.what() << endl;
@@ -292,11 +441,21 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    vector<int> read_families;
+    if (!umi_tag.empty()) {
+        size_t collapsed = collapseUmiFamilies(*reads, read_families);
+        cout << "Collapsed UMI families: " << collapsed << endl;
+    }
+    if (collapse_duplicates) {
+        size_t collapsed = collapseDuplicates(*reads, duplicate_quality_bins);
+        cout << "Collapsed duplicates: " << collapsed << endl;
+    }
+
     EdgeCalculator* edge_calculator = nullptr;
     EdgeCalculator* indel_edge_calculator = nullptr;
     unique_ptr<vector<mean_and_stddev_t> > readgroup_params(nullptr);
     max_position1 = (max_position1>max_position2) ? max_position1 : max_position2;
-    edge_calculator = new NewEdgeCalculator(Q, edge_quasi_cutoff_cliques, overlap_cliques, frameshift_merge, simpson_map, edge_quasi_cutoff_single, overlap_single, edge_quasi_cutoff_mixed, max_position1, no_prob0);
+    edge_calculator = new NewEdgeCalculator(Q, edge_quasi_cutoff_cliques, overlap_cliques, frameshift_merge, simpson_map, edge_quasi_cutoff_single, overlap_single, edge_quasi_cutoff_mixed, max_position1, no_prob0, max_mismatch_rate);
 
     if (call_indels) {
         double insert_mean = -1.0;
@@ -319,52 +478,139 @@ int main(int argc, char* argv[]) {
     std::vector<unsigned int> read_clique_counter (number_of_reads);
     if (logfile != "") lw = new LogWriter(logfile,read_clique_counter);
 
-    CliqueCollector collector(lw);
-    CliqueFinder* clique_finder;
-
-    if (args["bronkerbosch"].asBool()) {
-        clique_finder = new BronKerbosch(*edge_calculator, collector, lw);
-    } else {
-        clique_finder = new CLEVER(*edge_calculator, collector, lw, max_cliques, limit_clique_size, original_read_names.size(), filter_singletons);
+    if (incremental && (args["greedy"].asBool() || max_cliques != 0 || limit_clique_size != 0 || max_active_cliques != 0 || max_active_clique_bytes != 0 || prune_contained || lw != nullptr)) {
+        cerr << "Warning: --incremental is not used together with greedy, --max_cliques, --limit_clique_size, --max_active_cliques, --max_active_clique_bytes, --prune_contained or --log." << endl;
+        incremental = false;
     }
-    if (indel_edge_calculator != 0) {
-        clique_finder->setSecondEdgeCalculator(indel_edge_calculator);
+
+    CliqueCollector collector(lw);
+    collector.setThreads(threads);
+    collector.setMemoization(memoize_cliques);
+    collector.setSettledTracking(incremental);
+    bool tiling = threads > 1 && max_cliques == 0 && limit_clique_size == 0 && lw == nullptr;
+    auto create_finder = [&](const string& engine) {
+        CliqueFinder* finder;
+        if (engine == "bronkerbosch") {
+            BronKerbosch* bron_kerbosch = new BronKerbosch(*edge_calculator, collector, lw);
+            bron_kerbosch->setThreads(threads);
+            bron_kerbosch->setStreaming(stream_components);
+            finder = bron_kerbosch;
+        } else if (engine == "greedy") {
+            finder = new GreedyCliqueCover(*edge_calculator, collector, lw);
+        } else if (tiling) {
+            TiledCLEVER* tiled_clever = new TiledCLEVER(*edge_calculator, collector, threads);
+            tiled_clever->setActiveCliqueLimit(max_active_cliques, beam_width, max_active_clique_bytes);
+            finder = tiled_clever;
+        } else {
+            CLEVER* clever = new CLEVER(*edge_calculator, collector, lw, max_cliques, limit_clique_size, original_read_names.size(), filter_singletons);
+            clever->setThreads(threads);
+            clever->setActiveCliqueLimit(max_active_cliques, beam_width, max_active_clique_bytes);
+            finder = clever;
+        }
+        if (indel_edge_calculator != 0) {
+            finder->setSecondEdgeCalculator(indel_edge_calculator);
+        }
+        return finder;
+    };
+    string engine = "clever";
+    if (args["bronkerbosch"].asBool()) engine = "bronkerbosch";
+    if (args["greedy"].asBool()) engine = "greedy";
+    // with "auto", the engine is chosen at the start of every iteration
+    bool auto_engine = args["auto"].asBool();
+    if (threads > 1 && !tiling && engine == "clever") {
+        cerr << "Warning: no tiling together with --max_cliques, --limit_clique_size or --log, threads are only used for large clique updates." << endl;
     }
+    CliqueFinder* clique_finder = auto_engine ? nullptr : create_finder(engine);
     ofstream* reads_ofstream = 0;
 
     // Main loop
     int ct = 0;
     double stdev = 1.0;
-    auto filter_fn = [&](unique_ptr<AlignmentRecord>& read, int size) {
-        return (ct == 1 and filter_singletons and read->getReadCount() <= 1) or (ct > 1 and significance != 0.0 and read->getProbability() < 1.0 / size - significance*stdev);
+    auto filter_fn = [&](const AlignmentRecord& read, int size) {
+        return (ct == 1 and filter_singletons and read.getReadCount() <= 1) or (ct > 1 and significance != 0.0 and read.getProbability() < 1.0 / size - significance*stdev);
     };
     
     int edgecounter = 0;
+    vector<super_read_fingerprint_t> fingerprints;
+    if (convergence_threshold >= 0.0) fingerprints = fingerprintReads(*reads);
+    bool stopped = false;
     cout << "start: " << number_of_reads;
     while (ct != iterations) {
+        int size = reads->size();
+        if (max_mismatch_rate < 1.0) {
+            for (auto&& r : *reads) {
+                r->packBases();
+            }
+        }
+        if (auto_engine) {
+            GraphProfile profile(*reads, [&](const AlignmentRecord& read) { return filter_fn(read, size); }, *edge_calculator, indel_edge_calculator);
+            string choice = profile.prefersBronKerbosch() ? "bronkerbosch" : "clever";
+            cerr << "iteration " << ct << ": using " << choice << " (" << profile << ")" << endl;
+            if (clique_finder == nullptr || choice != engine) {
+                delete clique_finder;
+                engine = choice;
+                clique_finder = create_finder(engine);
+            }
+        }
+        vector<bool> carried;
+        if (incremental) {
+            carried = findCarriedReads(*reads, collector, [&](const AlignmentRecord& read) { return filter_fn(read, size); });
+            cout << "\tcarried: " << count(carried.begin(), carried.end(), true);
+        }
         clique_finder->initialize();
         if (lw != nullptr) lw->initialize();
-        int size = reads->size();
-        while(not reads->empty()) {
+        for (size_t i = 0; not reads->empty(); ++i) {
             assert(reads->front() != nullptr);
             unique_ptr<AlignmentRecord> al_ptr(reads->front());
             reads->pop_front();
-            if (filter_fn(al_ptr,size)) continue;
+            if (filter_fn(*al_ptr,size)) continue;
+            if (incremental && carried[i]) {
+                collector.carry(al_ptr);
+                continue;
+            }
             clique_finder->addAlignment(al_ptr,edgecounter);
         }
         
-        cout << "\tedges: " << edgecounter << endl;
-
         delete reads;
         clique_finder->finish();
+        cout << "\tedges: " << edgecounter << endl;
         reads = collector.finish();
         if (lw != nullptr) lw->finish();
 
         stdev = setProbabilities(*reads);
-        if (clique_finder->hasConverged()) break;
+        if (clique_finder->hasConverged()) {
+            cout << "stopped: no edges" << endl;
+            stopped = true;
+            break;
+        }
+        if (prune_contained) {
+            size_t pruned = pruneContainedReads(*reads);
+            if (pruned > 0) stdev = setProbabilities(*reads);
+            cout << "pruned: " << pruned << "\t";
+        }
         cout << ct++ << ": " << reads->size();
         edgecounter = 0;
+        if (convergence_threshold >= 0.0) {
+            vector<super_read_fingerprint_t> previous;
+            previous.swap(fingerprints);
+            fingerprints = fingerprintReads(*reads);
+            size_t changed = countChanged(previous, fingerprints);
+            double fraction = fingerprints.empty() ? 0.0 : (double) changed / fingerprints.size();
+            // the singleton filter of iteration 1 and the significance filter, which runs from
+            // iteration 2 on, remove reads that look settled, so stop only after both have run
+            bool filtered = ct > 2;
+            if (filtered && changed == 0 && previous.size() == fingerprints.size()) {
+                cout << "\tstopped: super reads unchanged" << endl;
+                stopped = true;
+                break;
+            } else if (filtered && convergence_threshold > 0.0 && fraction <= convergence_threshold) {
+                cout << "\tstopped: " << fraction << " of the super reads changed" << endl;
+                stopped = true;
+                break;
+            }
+        }
     }
+    if (!stopped) cout << "\tstopped: iteration limit" << endl;
 
     // Filter superreads according to read probability
     if (filter > 0.0) {
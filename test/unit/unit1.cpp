@@ -18,6 +18,85 @@
 using namespace std;
 using namespace boost;
 
+/** returns an edge calculator with the weak parameters of the HIV-1 simulation, which draw many edges, for reads
+ *  ending at or before max_position. */
+NewEdgeCalculator* weakEdgeCalculator(unsigned int max_position) {
+    std::unordered_map<int, double> simpson_map;
+    return new NewEdgeCalculator(0.9, 0.85, 0.6, false, simpson_map, 0.8, 0.5, 0.85, max_position, false);
+}
+
+/** runs one iteration of the clique finder on copies of the reads and returns the read sets of the
+ *  resulting super reads in sorted order. */
+vector<set<int>> findCliques(CliqueFinder& finder, CliqueCollector& collector, const deque<AlignmentRecord*>& reads) {
+    int edgecounter = 0;
+    finder.initialize();
+    for (auto&& r : reads) {
+        unique_ptr<AlignmentRecord> read(new AlignmentRecord(*r));
+        finder.addAlignment(read, edgecounter);
+    }
+    finder.finish();
+    deque<AlignmentRecord*>* super_reads = collector.finish();
+    vector<set<int>> cliques;
+    for (auto&& r : *super_reads) {
+        cliques.push_back(r->getReadNamesSet());
+        delete r;
+    }
+    delete super_reads;
+    sort(cliques.begin(), cliques.end());
+    return cliques;
+}
+
+/** runs haploclique with the given options on the HIV-1 reads and returns the super reads of the fasta file it
+ *  writes in sorted order and without the clique names, which only number the cliques. log receives what
+ *  haploclique prints. */
+vector<string> runHaploclique(vector<string> args, string* log = nullptr) {
+    string output = "unit_test_output";
+    args.insert(args.begin(), "haploclique");
+    args.push_back("test/data/simulation/reads_HIV-1_50_01.bam");
+    args.push_back(output);
+    vector<char*> argv;
+    for (auto&& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(HaploMain(argv.size(), argv.data()), 0);
+    string printed = testing::internal::GetCapturedStdout();
+    if (log != nullptr) *log = printed;
+    ifstream fasta(output + ".fasta");
+    vector<string> super_reads;
+    string line;
+    while (getline(fasta, line)) {
+        if (!line.empty() && line[0] == '>') {
+            super_reads.push_back(line.substr(line.find('|')));
+        } else if (!super_reads.empty()) {
+            super_reads.back() += "\n" + line;
+        }
+    }
+    std::remove((output + ".fasta").c_str());
+    sort(super_reads.begin(), super_reads.end());
+    return super_reads;
+}
+
+/** builds a mapped alignment with the given cigar, bases and qualities. */
+BamTools::BamAlignment testAlignment(const string& name, int position, const vector<BamTools::CigarOp>& cigar, const string& bases, const string& qualities) {
+    BamTools::BamAlignment alignment;
+    alignment.Name = name;
+    alignment.Position = position;
+    alignment.CigarData = cigar;
+    alignment.QueryBases = bases;
+    alignment.Qualities = qualities;
+    return alignment;
+}
+
+/** builds a read for tests that need reads with known positions; names receives the read name and the
+ *  index of the read in names is used as its id. */
+AlignmentRecord* testRead(vector<string>& names, int position, const vector<BamTools::CigarOp>& cigar, const string& bases, const string& qualities) {
+    string name = "read" + to_string(names.size());
+    AlignmentRecord* read = new AlignmentRecord(testAlignment(name, position, cigar, bases, qualities), names.size(), &names);
+    names.push_back(name);
+    return read;
+}
+
 // This test verifies if readBamFile function returns correct number of reads for a specific input file.
 TEST(readBamFileTest, readBamFileCountSeqs){
 
@@ -54,3 +133,397 @@ TEST(readBamFileExpectTest, readBamFileExpectReadsRetrival){
     }
 }
 
+
+// This test verifies that collapsing duplicate reads keeps every read name.
+TEST(readBamFileTest, collapseDuplicatesKeepsReads){
+
+    string bamfile = "test/data/simulation/reads_HIV-1_50_01.bam";
+    vector<string> originalReadNames;
+    unsigned int maxPosition1;
+    BamTools::SamHeader header;
+    BamTools::RefVector references;
+    std::deque<AlignmentRecord*>* reads = readBamFile(bamfile, originalReadNames,maxPosition1,header,references);
+
+    size_t removed = collapseDuplicates(*reads, 1);
+    unsigned int read_count = 0;
+    for (auto&& r : *reads) {
+        read_count += r->getReadCount();
+    }
+
+    EXPECT_EQ(originalReadNames.size(), reads->size() + removed);
+    EXPECT_EQ(originalReadNames.size(), read_count);
+
+    for (auto&& r : *reads) {
+        delete r;
+    }
+    delete reads;
+}
+
+// This test verifies that collapsing duplicates merges only reads with the same start, cigar string, bases and
+// quality bins, and that the representative keeps the read names of all its duplicates.
+TEST(readBamFileTest, collapseDuplicatesKeys){
+
+    vector<string> names;
+    vector<BamTools::CigarOp> match = {BamTools::CigarOp('M', 10)};
+    vector<BamTools::CigarOp> insertion = {BamTools::CigarOp('M', 5), BamTools::CigarOp('I', 1), BamTools::CigarOp('M', 4)};
+    string bases = "ACGTACGTAC";
+    deque<AlignmentRecord*> reads;
+    reads.push_back(testRead(names, 100, match, bases, string(10, 'I')));
+    reads.push_back(testRead(names, 100, match, bases, string(10, 'I')));
+    reads.push_back(testRead(names, 101, match, bases, string(10, 'I')));
+    reads.push_back(testRead(names, 100, insertion, bases, string(10, 'I')));
+    reads.push_back(testRead(names, 100, match, bases, string(9, 'I') + "5"));
+
+    EXPECT_EQ(collapseDuplicates(reads, 1), 1u);
+    ASSERT_EQ(reads.size(), 4u);
+    EXPECT_EQ(reads[0]->getReadNamesSet(), set<int>({0, 1}));
+    EXPECT_EQ(reads[1]->getReadNamesSet(), set<int>({2}));
+    EXPECT_EQ(reads[2]->getReadNamesSet(), set<int>({3}));
+    EXPECT_EQ(reads[3]->getReadNamesSet(), set<int>({4}));
+
+    for (auto&& r : reads) {
+        delete r;
+    }
+}
+
+// This test verifies that qualities only have to agree in bins of the given width: phred 30 and 39 share
+// a bin of width 10, phred 29 and 30 do not.
+TEST(readBamFileTest, collapseDuplicatesQualityBins){
+
+    vector<string> names;
+    vector<BamTools::CigarOp> match = {BamTools::CigarOp('M', 4)};
+    deque<AlignmentRecord*> reads;
+    reads.push_back(testRead(names, 100, match, "ACGT", string(4, 33 + 30)));
+    reads.push_back(testRead(names, 100, match, "ACGT", string(4, 33 + 39)));
+    reads.push_back(testRead(names, 100, match, "ACGT", string(4, 33 + 29)));
+
+    deque<AlignmentRecord*> exact;
+    for (auto&& r : reads) {
+        exact.push_back(new AlignmentRecord(*r));
+    }
+    EXPECT_EQ(collapseDuplicates(exact, 1), 0u);
+    EXPECT_EQ(exact.size(), 3u);
+
+    EXPECT_EQ(collapseDuplicates(reads, 10), 1u);
+    ASSERT_EQ(reads.size(), 2u);
+    EXPECT_EQ(reads[0]->getReadNamesSet(), set<int>({0, 1}));
+    EXPECT_EQ(reads[1]->getReadNamesSet(), set<int>({2}));
+
+    for (auto&& r : reads) {
+        delete r;
+    }
+    for (auto&& r : exact) {
+        delete r;
+    }
+}
+
+// This test verifies that reads are folded into UMI families by UMI and mapping positions of both mates,
+// that reads without UMI are kept, and that the probabilities count molecules instead of reads.
+TEST(readBamFileTest, collapseUmiFamilies){
+
+    vector<string> names;
+    vector<BamTools::CigarOp> match = {BamTools::CigarOp('M', 10)};
+    string bases = "ACGTACGTAC";
+    string qualities(10, 'I');
+    auto single = [&](const string& umi) {
+        AlignmentRecord* read = testRead(names, 100, match, bases, qualities);
+        read->setUmi(umi);
+        return read;
+    };
+    auto paired = [&](const string& umi, int mate_position) {
+        AlignmentRecord* read = single(umi);
+        read->pairWith(testAlignment(names.back(), mate_position, match, bases, qualities));
+        return read;
+    };
+    deque<AlignmentRecord*> reads;
+    reads.push_back(single("AAA"));
+    reads.push_back(single("AAA"));
+    reads.push_back(single("CCC"));
+    reads.push_back(single(""));
+    reads.push_back(single(""));
+    reads.push_back(paired("AAA", 200));
+    reads.push_back(paired("AAA", 210));
+    reads.push_back(paired("AAA", 200));
+
+    vector<int> read_families;
+    EXPECT_EQ(collapseUmiFamilies(reads, read_families), 2u);
+    EXPECT_EQ(read_families, vector<int>({0, 0, 2, 3, 4, 5, 6, 5}));
+    ASSERT_EQ(reads.size(), 6u);
+    EXPECT_EQ(reads[0]->getReadNamesSet(), set<int>({0, 1}));
+    EXPECT_TRUE(reads[4]->isPairedEnd());
+    EXPECT_EQ(reads[4]->getReadNamesSet(), set<int>({5, 7}));
+    EXPECT_EQ(reads[5]->getReadNamesSet(), set<int>({6}));
+
+    EXPECT_EQ(reads[0]->getReadCount(), 2u);
+    EXPECT_EQ(reads[0]->getMoleculeCount(), 1u);
+    setProbabilities(reads);
+    for (auto&& r : reads) {
+        EXPECT_DOUBLE_EQ(r->getProbability(), 1.0 / 6);
+    }
+
+    for (auto&& r : reads) {
+        delete r;
+    }
+}
+
+// This test verifies that a read lying within a longer read and agreeing with it is folded into that read,
+// while a read with a different base and a read extending beyond the end of the longer read are kept.
+TEST(readBamFileTest, pruneContainedReads){
+
+    vector<string> names;
+    string bases = "ACGTTGCAACGGTCATGCAT";
+    deque<AlignmentRecord*> reads;
+    reads.push_back(testRead(names, 105, {BamTools::CigarOp('M', 10)}, bases.substr(5, 10), string(10, 'I')));
+    reads.push_back(testRead(names, 100, {BamTools::CigarOp('M', 20)}, bases, string(20, 'I')));
+    string mismatch = bases.substr(5, 10);
+    mismatch[4] = 'A';
+    reads.push_back(testRead(names, 105, {BamTools::CigarOp('M', 10)}, mismatch, string(10, 'I')));
+    reads.push_back(testRead(names, 115, {BamTools::CigarOp('M', 10)}, bases.substr(15, 5) + "ACGTA", string(10, 'I')));
+
+    EXPECT_EQ(pruneContainedReads(reads), 1u);
+    ASSERT_EQ(reads.size(), 3u);
+    EXPECT_EQ(reads[0]->getReadNamesSet(), set<int>({0, 1}));
+    EXPECT_EQ(reads[1]->getReadNamesSet(), set<int>({2}));
+    EXPECT_EQ(reads[2]->getReadNamesSet(), set<int>({3}));
+
+    for (auto&& r : reads) {
+        delete r;
+    }
+}
+
+// This test verifies that cutting the reads into many small tiles finds the same cliques as a single CLEVER
+// sweep, including the cliques of reads that cross the cuts between tiles.
+TEST(cliqueFinderTest, tiledCleverMatchesClever){
+
+    string bamfile = "test/data/simulation/reads_HIV-1_50_01.bam";
+    vector<string> originalReadNames;
+    unsigned int maxPosition1;
+    BamTools::SamHeader header;
+    BamTools::RefVector references;
+    std::deque<AlignmentRecord*>* reads = readBamFile(bamfile, originalReadNames,maxPosition1,header,references);
+    unique_ptr<NewEdgeCalculator> edge_calculator(weakEdgeCalculator(maxPosition1));
+
+    CliqueCollector collector(nullptr);
+    CLEVER clever(*edge_calculator, collector, nullptr, 0, 0, originalReadNames.size(), false);
+    vector<set<int>> expected = findCliques(clever, collector, *reads);
+
+    TiledCLEVER tiled(*edge_calculator, collector, 4);
+    tiled.setMinTileSize(50);
+    int edgecounter = 0;
+    tiled.initialize();
+    for (auto&& r : *reads) {
+        unique_ptr<AlignmentRecord> read(new AlignmentRecord(*r));
+        tiled.addAlignment(read, edgecounter);
+    }
+    vector<size_t> breakpoints = tiled.findBreakpoints();
+    EXPECT_GT(breakpoints.size(), 4u);
+    // read sets of the reads crossing a cut
+    set<int> crossing;
+    for (size_t k = 1; k < breakpoints.size(); ++k) {
+        unsigned int cut = tiled.getAlignmentByIndex(breakpoints[k]).getIntervalStart();
+        for (size_t j = breakpoints[k-1]; j < breakpoints[k]; ++j) {
+            const AlignmentRecord& read = tiled.getAlignmentByIndex(j);
+            if (read.getIntervalEnd() >= cut) crossing.insert(read.getReadNamesSet().begin(), read.getReadNamesSet().end());
+        }
+    }
+    tiled.finish();
+    deque<AlignmentRecord*>* super_reads = collector.finish();
+    vector<set<int>> cliques;
+    for (auto&& r : *super_reads) {
+        cliques.push_back(r->getReadNamesSet());
+        delete r;
+    }
+    delete super_reads;
+    sort(cliques.begin(), cliques.end());
+
+    EXPECT_EQ(cliques, expected);
+    size_t crossing_cliques = 0;
+    for (const auto& clique : cliques) {
+        if (clique.size() < 2) continue;
+        for (int read : clique) {
+            if (crossing.count(read) > 0) {
+                ++crossing_cliques;
+                break;
+            }
+        }
+    }
+    EXPECT_GT(crossing_cliques, 0u);
+
+    for (auto&& r : *reads) {
+        delete r;
+    }
+    delete reads;
+}
+
+// This test verifies that a small budget of active cliques or of their memory, which prunes cliques in most
+// regions, still reports every read in some clique.
+TEST(cliqueFinderTest, activeCliqueLimitKeepsReads){
+
+    string bamfile = "test/data/simulation/reads_HIV-1_50_01.bam";
+    vector<string> originalReadNames;
+    unsigned int maxPosition1;
+    BamTools::SamHeader header;
+    BamTools::RefVector references;
+    std::deque<AlignmentRecord*>* reads = readBamFile(bamfile, originalReadNames,maxPosition1,header,references);
+    unique_ptr<NewEdgeCalculator> edge_calculator(weakEdgeCalculator(maxPosition1));
+
+    CliqueCollector collector(nullptr);
+    CLEVER unbounded(*edge_calculator, collector, nullptr, 0, 0, originalReadNames.size(), false);
+    vector<set<int>> exact = findCliques(unbounded, collector, *reads);
+    CLEVER clever(*edge_calculator, collector, nullptr, 0, 0, originalReadNames.size(), false);
+    clever.setActiveCliqueLimit(4, 2, 0);
+    vector<set<int>> cliques = findCliques(clever, collector, *reads);
+
+    EXPECT_NE(cliques, exact);
+    set<int> covered;
+    for (const auto& clique : cliques) {
+        covered.insert(clique.begin(), clique.end());
+    }
+    EXPECT_EQ(covered.size(), originalReadNames.size());
+
+    // the same for a budget of the memory of the active cliques
+    CLEVER memory_bounded(*edge_calculator, collector, nullptr, 0, 0, originalReadNames.size(), false);
+    memory_bounded.setActiveCliqueLimit(0, 1000, 1024);
+    cliques = findCliques(memory_bounded, collector, *reads);
+    EXPECT_NE(cliques, exact);
+    covered.clear();
+    for (const auto& clique : cliques) {
+        covered.insert(clique.begin(), clique.end());
+    }
+    EXPECT_EQ(covered.size(), originalReadNames.size());
+
+    for (auto&& r : *reads) {
+        delete r;
+    }
+    delete reads;
+}
+
+// This test verifies that the greedy clique cover reports every read in some clique and that every reported
+// read set is a clique of the read graph.
+TEST(cliqueFinderTest, greedyCliqueCoverIsCover){
+
+    string bamfile = "test/data/simulation/reads_HIV-1_50_01.bam";
+    vector<string> originalReadNames;
+    unsigned int maxPosition1;
+    BamTools::SamHeader header;
+    BamTools::RefVector references;
+    std::deque<AlignmentRecord*>* reads = readBamFile(bamfile, originalReadNames,maxPosition1,header,references);
+    unique_ptr<NewEdgeCalculator> edge_calculator(weakEdgeCalculator(maxPosition1));
+
+    CliqueCollector collector(nullptr);
+    GreedyCliqueCover greedy(*edge_calculator, collector, nullptr);
+    vector<set<int>> cliques = findCliques(greedy, collector, *reads);
+
+    // before the first iteration every read carries a single name
+    map<int, const AlignmentRecord*> read_by_name;
+    for (auto&& r : *reads) {
+        ASSERT_EQ(r->getReadNamesSet().size(), 1u);
+        read_by_name[*r->getReadNamesSet().begin()] = r;
+    }
+    set<int> covered;
+    size_t edges = 0;
+    for (const auto& clique : cliques) {
+        covered.insert(clique.begin(), clique.end());
+        for (auto a = clique.begin(); a != clique.end(); ++a) {
+            for (auto b = std::next(a); b != clique.end(); ++b) {
+                EXPECT_TRUE(edge_calculator->edgeBetween(*read_by_name[*a], *read_by_name[*b]));
+                ++edges;
+            }
+        }
+    }
+    EXPECT_EQ(covered.size(), originalReadNames.size());
+    EXPECT_GT(edges, 0u);
+
+    for (auto&& r : *reads) {
+        delete r;
+    }
+    delete reads;
+}
+
+// This test verifies that BronKerbosch finds the same cliques on a fixed read graph when it enumerates the
+// components while reading, after reading, or on several threads, and that these are the cliques of CLEVER.
+TEST(cliqueFinderTest, bronKerboschModesMatchClever){
+
+    string bamfile = "test/data/simulation/reads_HIV-1_50_01.bam";
+    vector<string> originalReadNames;
+    unsigned int maxPosition1;
+    BamTools::SamHeader header;
+    BamTools::RefVector references;
+    std::deque<AlignmentRecord*>* reads = readBamFile(bamfile, originalReadNames,maxPosition1,header,references);
+    unique_ptr<NewEdgeCalculator> edge_calculator(weakEdgeCalculator(maxPosition1));
+
+    CliqueCollector collector(nullptr);
+    CLEVER clever(*edge_calculator, collector, nullptr, 0, 0, originalReadNames.size(), false);
+    vector<set<int>> expected = findCliques(clever, collector, *reads);
+    EXPECT_GT(expected.size(), 1000u);
+
+    BronKerbosch batch(*edge_calculator, collector, nullptr);
+    EXPECT_EQ(findCliques(batch, collector, *reads), expected);
+
+    BronKerbosch streaming(*edge_calculator, collector, nullptr);
+    streaming.setStreaming(true);
+    EXPECT_EQ(findCliques(streaming, collector, *reads), expected);
+
+    BronKerbosch threaded(*edge_calculator, collector, nullptr);
+    threaded.setThreads(4);
+    EXPECT_EQ(findCliques(threaded, collector, *reads), expected);
+
+    BronKerbosch streaming_threaded(*edge_calculator, collector, nullptr);
+    streaming_threaded.setThreads(4);
+    streaming_threaded.setStreaming(true);
+    EXPECT_EQ(findCliques(streaming_threaded, collector, *reads), expected);
+
+    for (auto&& r : *reads) {
+        delete r;
+    }
+    delete reads;
+}
+
+// This test verifies that reusing the super reads of the previous iteration and dropping duplicate cliques
+// does not change the sequences and headers haploclique reports for the HIV-1 reads. Reuse is an
+// approximation, so qualities may differ.
+TEST(haplocliqueTest, memoizationKeepsSuperReads){
+
+    vector<string> weak = {"--edge_quasi_cutoff_cliques=0.85", "--edge_quasi_cutoff_mixed=0.85", "--edge_quasi_cutoff_single=0.8", "--min_overlap_cliques=0.6", "--min_overlap_single=0.5", "--no_singletons", "--significance=4"};
+    vector<string> expected = runHaploclique(weak);
+    EXPECT_GT(expected.size(), 100u);
+    weak.push_back("--memoize_cliques");
+    EXPECT_EQ(runHaploclique(weak), expected);
+    weak.push_back("--threads=4");
+    EXPECT_EQ(runHaploclique(weak), expected);
+}
+
+// This test verifies that stopping once the super reads stay the same reports the super reads that further
+// iterations report.
+TEST(haplocliqueTest, convergenceKeepsSuperReads){
+
+    // a small budget of active cliques leaves edges between super reads that do not change any more
+    vector<string> options = {"--max_active_cliques=4", "--edge_quasi_cutoff_cliques=0.85", "--edge_quasi_cutoff_mixed=0.85", "--edge_quasi_cutoff_single=0.8", "--min_overlap_cliques=0.6", "--min_overlap_single=0.5"};
+    string log;
+    vector<string> converged = runHaploclique(options, &log);
+    size_t stop = log.find("\tstopped: super reads unchanged");
+    ASSERT_NE(stop, string::npos);
+    // the line of the stop starts with the number of the last iteration
+    int last = stoi(log.substr(log.rfind('\n', stop) + 1));
+    EXPECT_GT(last, 2);
+    options.push_back("--convergence_threshold=-1");
+    options.push_back("--iterations=" + to_string(last + 3));
+    EXPECT_EQ(runHaploclique(options, &log), converged);
+    EXPECT_NE(log.find("stopped: iteration limit"), string::npos);
+}
+
+// This test verifies that passing settled super reads on without searching cliques among them again reports
+// the same super reads as searching all of them.
+TEST(haplocliqueTest, incrementalKeepsSuperReads){
+
+    vector<string> weak = {"--edge_quasi_cutoff_cliques=0.85", "--edge_quasi_cutoff_mixed=0.85", "--edge_quasi_cutoff_single=0.8", "--min_overlap_cliques=0.6", "--min_overlap_single=0.5", "--no_singletons", "--significance=4"};
+    vector<string> expected = runHaploclique(weak);
+    weak.push_back("--incremental");
+    string log;
+    EXPECT_EQ(runHaploclique(weak, &log), expected);
+    size_t carried = 0;
+    for (size_t pos = log.find("carried: "); pos != string::npos; pos = log.find("carried: ", pos + 1)) {
+        carried = max(carried, (size_t) stoul(log.substr(pos + 9)));
+    }
+    EXPECT_GT(carried, 0u);
+}
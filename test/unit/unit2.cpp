@@ -295,3 +295,40 @@ TEST(edgeBetweenFunctionTest, edgeBetweenIncompatibleAlignments2){
     
     delete edge_calculator;
 }
+
+// This test verifies the packed mismatch count and that a zero mismatch budget keeps edges between identical AlignmentRecords.
+TEST(edgeBetweenFunctionTest, edgeBetweenMismatchBudget){
+    
+    AlignmentRecord alignment1;
+    AlignmentRecord alignment2;
+    EdgeCalculator* edge_calculator = nullptr;
+    
+    alignment1.restoreCompleteAlignmentRecord("test/data/simulation/unit_data/alignment_sample00.txt");
+    alignment2.restoreCompleteAlignmentRecord("test/data/simulation/unit_data/alignment_sample08.txt");
+    alignment1.packBases();
+    alignment2.packBases();
+    
+    unsigned int overlap = 0;
+    EXPECT_EQ(alignment1.countMismatches(alignment1, overlap), 0u);
+    EXPECT_EQ(overlap, alignment1.getCovmap().size());
+    EXPECT_GT(alignment1.countMismatches(alignment2, overlap), 0u);
+    
+    double Q = 0.9;
+    double edge_quasi_cutoff_cliques = 0.99;
+    double overlap_cliques = 0.9;
+    bool frameshift_merge = false;
+    std::unordered_map<int, double> simpson_map;
+    double edge_quasi_cutoff_single = 0.95;
+    double overlap_single = 0.6;
+    double edge_quasi_cutoff_mixed = 0.97;
+    unsigned int maxPosition1 = 0;
+    bool noProb0 = false;
+    double max_mismatch_rate = 0.0;
+    
+    edge_calculator = new NewEdgeCalculator(Q, edge_quasi_cutoff_cliques, overlap_cliques, frameshift_merge, simpson_map, edge_quasi_cutoff_single, overlap_single, edge_quasi_cutoff_mixed, maxPosition1, noProb0, max_mismatch_rate);
+    
+    EXPECT_EQ(edge_calculator->edgeBetween(alignment1, alignment1), true);
+    EXPECT_EQ(edge_calculator->edgeBetween(alignment1, alignment2), false);
+    
+    delete edge_calculator;
+}
@@ -90,3 +90,106 @@ TEST(mergeAlignmentRecordsFunctionTest, mergeAlignmentRecordsDebug){
     
     EXPECT_EQ(mergeRes, true);
 }
+
+// This test verifies that merging three single end AlignmentRecords in one pass gives the same
+// super read as merging them one after another.
+TEST(mergeAlignmentRecordsFunctionTest, mergeAlignmentRecordsPileup){
+
+    AlignmentRecord ar;
+    AlignmentRecord alignment;
+
+    try{
+        alignment.restoreCompleteAlignmentRecord("test/data/simulation/unit_data/alignment_sample00.txt");
+        ar.restoreCompleteAlignmentRecord("test/data/simulation/unit_data/alignment_sample10.txt");
+    }catch (...){
+        cout << "File not found!" << endl;
+    }
+
+    std::unique_ptr<std::vector<const AlignmentRecord*>> pair(new vector<const AlignmentRecord*>());
+    pair->push_back(&alignment);
+    pair->push_back(&ar);
+    AlignmentRecord first_merge(pair, 1);
+
+    std::unique_ptr<std::vector<const AlignmentRecord*>> folded(new vector<const AlignmentRecord*>());
+    folded->push_back(&first_merge);
+    folded->push_back(&alignment);
+    AlignmentRecord pairwise(folded, 2);
+
+    std::unique_ptr<std::vector<const AlignmentRecord*>> all(new vector<const AlignmentRecord*>());
+    all->push_back(&alignment);
+    all->push_back(&ar);
+    all->push_back(&alignment);
+    AlignmentRecord pileup(all, 2);
+
+    EXPECT_TRUE(pileup == pairwise);
+    EXPECT_EQ(pileup.getSequence1().toString(), pairwise.getSequence1().toString());
+
+    // the constructor above takes the pileup pass for these alignments
+    AlignmentRecord direct(alignment);
+    EXPECT_TRUE(direct.pileupMergeSingle(*all, all->size()));
+    EXPECT_TRUE(direct == pairwise);
+}
+
+/** builds a single end read at the given position from its cigar and bases. */
+AlignmentRecord* singleEndRead(vector<string>& names, int position, const vector<BamTools::CigarOp>& cigar, const string& bases) {
+    BamTools::BamAlignment alignment;
+    alignment.Name = "read" + to_string(names.size());
+    alignment.Position = position;
+    alignment.CigarData = cigar;
+    alignment.QueryBases = bases;
+    alignment.Qualities = string(bases.size(), 'I');
+    AlignmentRecord* read = new AlignmentRecord(alignment, names.size(), &names);
+    names.push_back(alignment.Name);
+    return read;
+}
+
+/** checks that the pileup pass gives up on the given reads without changing the record it merges into. */
+void expectPileupRejects(const AlignmentRecord& read1, const AlignmentRecord& read2, const AlignmentRecord& read3) {
+    vector<const AlignmentRecord*> all({&read1, &read2, &read3});
+    AlignmentRecord direct(read1);
+    EXPECT_FALSE(direct.pileupMergeSingle(all, all.size()));
+    EXPECT_TRUE(direct == read1);
+    EXPECT_EQ(direct.getReadCount(), 1u);
+}
+
+// This test verifies that the pileup pass gives up on a match against a deletion in the same column. The
+// pairwise merge does not resolve such columns either, so edges are never drawn between such reads.
+TEST(mergeAlignmentRecordsFunctionTest, mergeAlignmentRecordsPileupDeletion){
+
+    vector<string> names;
+    unique_ptr<AlignmentRecord> read1(singleEndRead(names, 100, {BamTools::CigarOp('M', 10)}, "ACGTACGTAC"));
+    unique_ptr<AlignmentRecord> read2(singleEndRead(names, 100, {BamTools::CigarOp('M', 4), BamTools::CigarOp('D', 1), BamTools::CigarOp('M', 5)}, "ACGTCGTAC"));
+    unique_ptr<AlignmentRecord> read3(singleEndRead(names, 100, {BamTools::CigarOp('M', 10)}, "ACGTACGTAC"));
+    expectPileupRejects(*read1, *read2, *read3);
+}
+
+// This test verifies that the pileup pass gives up on insertions of different lengths at the same position.
+TEST(mergeAlignmentRecordsFunctionTest, mergeAlignmentRecordsPileupInsertions){
+
+    vector<string> names;
+    unique_ptr<AlignmentRecord> read1(singleEndRead(names, 100, {BamTools::CigarOp('M', 5), BamTools::CigarOp('I', 2), BamTools::CigarOp('M', 5)}, "ACGTATTCGTAC"));
+    unique_ptr<AlignmentRecord> read2(singleEndRead(names, 100, {BamTools::CigarOp('M', 5), BamTools::CigarOp('I', 1), BamTools::CigarOp('M', 5)}, "ACGTATCGTAC"));
+    unique_ptr<AlignmentRecord> read3(singleEndRead(names, 100, {BamTools::CigarOp('M', 5), BamTools::CigarOp('I', 2), BamTools::CigarOp('M', 5)}, "ACGTATTCGTAC"));
+    expectPileupRejects(*read1, *read2, *read3);
+}
+
+// This test verifies that the pileup pass gives up on an insertion at the end of another read, and that the
+// clique is then merged pairwise.
+TEST(mergeAlignmentRecordsFunctionTest, mergeAlignmentRecordsPileupInsertionAtEnd){
+
+    vector<string> names;
+    unique_ptr<AlignmentRecord> read1(singleEndRead(names, 100, {BamTools::CigarOp('M', 5), BamTools::CigarOp('I', 2), BamTools::CigarOp('M', 5)}, "ACGTATTCGTAC"));
+    unique_ptr<AlignmentRecord> read2(singleEndRead(names, 100, {BamTools::CigarOp('M', 5)}, "ACGTA"));
+    unique_ptr<AlignmentRecord> read3(singleEndRead(names, 100, {BamTools::CigarOp('M', 5), BamTools::CigarOp('I', 2), BamTools::CigarOp('M', 5)}, "ACGTATTCGTAC"));
+    expectPileupRejects(*read1, *read2, *read3);
+
+    std::unique_ptr<std::vector<const AlignmentRecord*>> pair(new vector<const AlignmentRecord*>({read1.get(), read2.get()}));
+    AlignmentRecord first_merge(pair, 1);
+    std::unique_ptr<std::vector<const AlignmentRecord*>> folded(new vector<const AlignmentRecord*>({&first_merge, read3.get()}));
+    AlignmentRecord pairwise(folded, 2);
+    std::unique_ptr<std::vector<const AlignmentRecord*>> all(new vector<const AlignmentRecord*>({read1.get(), read2.get(), read3.get()}));
+    AlignmentRecord merged(all, 2);
+    EXPECT_TRUE(merged == pairwise);
+    EXPECT_EQ(merged.getReadCount(), 3u);
+    EXPECT_EQ(merged.getSequence1().toString(), "ACGTATTCGTAC");
+}